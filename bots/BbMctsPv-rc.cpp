@@ -25,12 +25,27 @@ using namespace std;
 #define PRINT_DEBUG_DATA 1 & USE_VISUAL_BOARD
 #define PRINT_TURNS      0 & USE_VISUAL_BOARD
 
+// Builds the self-play data generator instead of the bot, see mains/selfplay.cpp
+#ifndef SELFPLAY
+#define SELFPLAY 0
+#endif
+
+// Maintains the NNUE accumulators of the boards, only needed when NnueHeuristic evaluates
+#ifndef USE_NNUE
+#define USE_NNUE 0
+#endif
+
 #define EMPTY_CELL '-'
 
 #define BITMASK_ALL_CELLS   0xFFFFFFFFFFFFFFFFUL
 #define BITMASK_WHITE_CELLS 0xAA55AA55AA55AA55UL
 #define BITMASK_BLACK_CELLS 0x55AA55AA55AA55AAUL
 
+#define BITMASK_NOT_FILE_A  0xFEFEFEFEFEFEFEFEUL
+#define BITMASK_NOT_FILE_AB 0xFCFCFCFCFCFCFCFCUL
+#define BITMASK_NOT_FILE_H  0x7F7F7F7F7F7F7F7FUL
+#define BITMASK_NOT_FILE_GH 0x3F3F3F3F3F3F3F3FUL
+
 #define BITMASK_LINE_81 0xFF000000000000FFUL
 #define BITMASK_LINE_7  0x000000000000FF00UL
 #define BITMASK_LINE_65 0x00000000FFFF0000UL
@@ -63,6 +78,25 @@ enum castle_info_e
     BLACKRIGHT
 };
 
+enum color_e
+{
+    WHITE,
+    BLACK
+};
+
+enum piece_type_e
+{
+    PAWN,
+    KNIGHT,
+    BISHOP,
+    ROOK,
+    QUEEN,
+    KING
+};
+
+// Pieces are indexed by color * 6 + type, EMPTY_CELL's index comes right after
+#define NO_PIECE 12
+
 enum ray_dir_e
 {
     NORTH,
@@ -110,6 +144,19 @@ inline wchar_t convert_piece_to_unicode(char piece)
     }
 }
 
+inline int piece_to_index(char piece)
+{
+    const char *pieces = "PNBRQKpnbrqk";
+    const char *found = piece ? strchr(pieces, piece) : nullptr;
+
+    return found ? found - pieces : NO_PIECE;
+}
+
+inline char index_to_piece(int piece_index)
+{
+    return "PNBRQKpnbrqk-"[piece_index];
+}
+
 /* NOTATION FUNCTIONS */
 
 inline int column_name_to_index(char column_name)
@@ -241,6 +288,68 @@ class Move
 
 #endif
 
+/*
+        Content of 'srcs/chessengine/Nnue.hpp'
+*/
+
+#ifndef NNUE_HPP
+#define NNUE_HPP
+
+// 768 -> 2x16 -> 1 network, features being (piece color and type, cell) from each side's view
+#define NNUE_FEATURES_COUNT 768
+#define NNUE_HIDDEN_SIZE    16
+// Accumulators are clipped to [0, NNUE_ACTIVATION_MAX], the output is in 1/NNUE_OUTPUT_SCALE cp
+#define NNUE_ACTIVATION_MAX 255
+#define NNUE_OUTPUT_SCALE   8
+
+#if USE_NNUE == 1
+
+#include <immintrin.h>
+
+class Nnue
+{
+        /*
+        Quantized network, read once from the byte array embedded in Nnue.cpp (little-endian):
+
+        int8  feature_weights[768][16]
+        int16 feature_biases[16]
+        int8  output_weights[2][16]   (side to move accumulator, then the other one)
+        int32 output_bias
+
+        With USE_NNUE, boards keep both first layer accumulators up to date, features being added
+        and removed along with their pieces, so an evaluation only has to run the output layer.
+        */
+
+    public:
+        static int  feature_index(int perspective, int piece, int lkt_i);
+        static void initialize_accumulator(int16_t *accumulator);
+        static void add_feature(int16_t *accumulator, int feature);
+        static void remove_feature(int16_t *accumulator, int feature);
+
+        // Centipawns, from the point of view of the side owning the first accumulator
+        static int evaluate(const int16_t *ally_accumulator, const int16_t *enemy_accumulator);
+
+    private:
+        static int8_t  feature_weights[NNUE_FEATURES_COUNT][NNUE_HIDDEN_SIZE];
+        static int16_t feature_biases[NNUE_HIDDEN_SIZE];
+        static int8_t  output_weights[2][NNUE_HIDDEN_SIZE];
+        static int32_t output_bias;
+
+        static const bool weights_loaded;
+        static const bool avx2_supported;
+
+        static bool _load_weights();
+
+        static void _add_feature_avx2(int16_t *accumulator, const int8_t *weights);
+        static void _remove_feature_avx2(int16_t *accumulator, const int8_t *weights);
+        static int
+        _evaluate_avx2(const int16_t *ally_accumulator, const int16_t *enemy_accumulator);
+};
+
+#endif
+
+#endif
+
 /*
         Content of 'srcs/chessengine/Board.hpp'
 */
@@ -250,7 +359,31 @@ class Move
 
 #pragma region Board
 
-#define FEN_HISTORY_SIZE 50
+// Positions kept for the threefold repetition rule
+#define POSITION_HISTORY_SIZE 50
+
+// Zobrist keys rows, after the 12 pieces ones
+#define ZOBRIST_CASTLES    12
+#define ZOBRIST_EN_PASSANT 13
+#define ZOBRIST_BLACK_TURN 14
+
+struct PackedBoard
+{
+        /*
+        Fixed size position, for datasets: the pieces of the occupied cells are listed by
+        increasing cell index, two 4-bit piece indexes per byte.
+        */
+        uint64_t occupancy;
+        uint8_t  pieces[16];
+        uint8_t  castling_files[2]; // Files of the castling rooks, by color
+        uint8_t  white_turn;
+        uint8_t  en_passant_file; // 8 when there is no en passant
+        uint8_t  half_turn_rule;
+        uint8_t  reserved;
+        uint16_t game_turn;
+};
+
+static_assert(sizeof(PackedBoard) == 32, "PackedBoard must stay packed");
 
 class Board
 {
@@ -267,8 +400,7 @@ class Board
 
         bool white_turn;
 
-        uint64_t white_castles;
-        uint64_t black_castles;
+        uint64_t castles[2];
 
         uint64_t en_passant;
         uint64_t next_turn_en_passant;
@@ -279,31 +411,85 @@ class Board
         VisualBoard visual_board;
 #endif
 
-        int      game_turn;
-        uint64_t white_pawns;
-        uint64_t white_knights;
-        uint64_t white_bishops;
-        uint64_t white_rooks;
-        uint64_t white_queens;
-        uint64_t white_king;
-        uint64_t black_pawns;
-        uint64_t black_knights;
-        uint64_t black_bishops;
-        uint64_t black_rooks;
-        uint64_t black_queens;
-        uint64_t black_king;
+        int game_turn;
+
+        // Bitboards are indexed by [color_e][piece_type_e], see the named accessors below
+        uint64_t bitboards[2][6];
+        uint8_t  piece_on[64];
 
         uint64_t all_pieces_mask;
         uint64_t empty_cells_mask;
-        uint64_t white_pieces_mask;
-        uint64_t black_pieces_mask;
+        uint64_t pieces_masks[2];
         uint64_t not_white_pieces_mask;
         uint64_t not_black_pieces_mask;
         uint64_t uncheck_mask;
         uint64_t pawn_uncheck_mask;
-        uint64_t attacked_by_white_mask;
-        uint64_t attacked_by_black_mask;
+        uint64_t pinned_mask;
+        // Only the entries of the pieces in pinned_mask are valid
         uint64_t pin_masks[64];
+#if USE_NNUE == 1
+        // First layer of the network, from each color's point of view, see Nnue.hpp
+        int16_t nnue_accumulators[2][NNUE_HIDDEN_SIZE];
+#endif
+
+        // Named views of bitboards and pieces_masks
+        inline uint64_t white_pawns() const
+        {
+            return bitboards[WHITE][PAWN];
+        }
+        inline uint64_t white_knights() const
+        {
+            return bitboards[WHITE][KNIGHT];
+        }
+        inline uint64_t white_bishops() const
+        {
+            return bitboards[WHITE][BISHOP];
+        }
+        inline uint64_t white_rooks() const
+        {
+            return bitboards[WHITE][ROOK];
+        }
+        inline uint64_t white_queens() const
+        {
+            return bitboards[WHITE][QUEEN];
+        }
+        inline uint64_t white_king() const
+        {
+            return bitboards[WHITE][KING];
+        }
+        inline uint64_t white_pieces_mask() const
+        {
+            return pieces_masks[WHITE];
+        }
+        inline uint64_t black_pawns() const
+        {
+            return bitboards[BLACK][PAWN];
+        }
+        inline uint64_t black_knights() const
+        {
+            return bitboards[BLACK][KNIGHT];
+        }
+        inline uint64_t black_bishops() const
+        {
+            return bitboards[BLACK][BISHOP];
+        }
+        inline uint64_t black_rooks() const
+        {
+            return bitboards[BLACK][ROOK];
+        }
+        inline uint64_t black_queens() const
+        {
+            return bitboards[BLACK][QUEEN];
+        }
+        inline uint64_t black_king() const
+        {
+            return bitboards[BLACK][KING];
+        }
+        inline uint64_t black_pieces_mask() const
+        {
+            return pieces_masks[BLACK];
+        }
+
         Board();
         Board(string _fen, bool chess960_rule = true, bool codingame_rule = true);
         Board(
@@ -316,6 +502,7 @@ class Board
             bool   chess960_rule = true,
             bool   codingame_rule = true
         );
+        Board(const PackedBoard &packed, bool chess960_rule = true, bool codingame_rule = true);
 
         inline bool is_white_turn()
         {
@@ -324,14 +511,36 @@ class Board
         char          get_cell(int x, int y);
         float         get_game_state();
         bool          get_check_state();
+        uint64_t      get_attacked_cells_mask(int color);
         uint64_t      get_castling_rights();
+        uint64_t      get_hash();
         static string get_name();
 
+        inline uint64_t get_pawns_hash()
+        {
+            return pawns_hash;
+        }
+
         string create_fen(bool with_turns = true);
+        void   pack(PackedBoard *packed);
         Board *clone();
 
         vector<Move> get_available_moves();
         void         apply_move(Move move);
+        void         apply_null_move();
+
+        // Pieces of both colors attacking the square, sliders being blocked by occupancy
+        uint64_t attackers_to(int square, uint64_t occupancy);
+
+        // Staged generation: pseudo-legal moves are only checked with is_legal_move when tried
+        void find_pseudo_legal_moves(vector<Move> *moves, bool captures);
+        bool is_pseudo_legal_move(Move &move);
+        bool is_capture_move(Move &move);
+        bool is_legal_move(Move &move);
+
+        // Static exchange evaluation: material won on the destination cell, in centipawns
+        int  see(Move &move);
+        bool see_ge(Move &move, int threshold);
 
         void log(bool raw = false);
 
@@ -342,10 +551,19 @@ class Board
         bool         check_state;
         bool         double_check;
         bool         engine_data_updated;
+        bool         ally_attacked_cells_computed;
         vector<Move> available_moves;
         float        game_state;
         bool         game_state_computed;
 
+        // Read through get_attacked_cells_mask(): the enemy mask is only valid once the engine data
+        // is updated, and the ally one once ally_attacked_cells_computed is set
+        uint64_t attacked_by_masks[2];
+
+        // Zobrist keys of the pieces placement, updated along with the bitboards and accumulators
+        uint64_t pieces_hash;
+        uint64_t pawns_hash;
+
         uint64_t ally_king;
         uint64_t ally_pieces;
 
@@ -361,8 +579,9 @@ class Board
         uint64_t capturable_by_white_pawns_mask;
         uint64_t capturable_by_black_pawns_mask;
 
-        string fen_history[FEN_HISTORY_SIZE];
-        int    fen_history_index;
+        // Zobrist keys of the last positions, a circular buffer
+        uint64_t position_history[POSITION_HISTORY_SIZE];
+        int      position_history_index;
 
         void _main_parsing(
             string _board,
@@ -375,6 +594,7 @@ class Board
             bool   _codingame_rule
         );
         void _initialize_bitboards();
+        void _initialize_engine_data();
         void _parse_board(string fen_board);
         void _parse_castling(string castling_fen);
 
@@ -382,70 +602,58 @@ class Board
         void _create_fen_for_standard_castling(char *fen, int *fen_i);
         void _create_fen_for_chess960_castling(char *fen, int *fen_i);
 
-        void _apply_regular_white_move(uint64_t src, uint64_t dst, uint64_t *piece_mask);
-        void _apply_regular_black_move(uint64_t src, uint64_t dst, uint64_t *piece_mask);
-        void _move_white_pawn(uint64_t src, uint64_t dst, char promotion);
-        void _move_black_pawn(uint64_t src, uint64_t dst, char promotion);
-        void _move_white_king(uint64_t src, uint64_t dst, castle_info_e castle_info);
-        void _move_black_king(uint64_t src, uint64_t dst, castle_info_e castle_info);
-        void _capture_white_pieces(uint64_t dst);
-        void _capture_black_pieces(uint64_t dst);
+        void _apply_regular_move(int color, int type, int src_lkt_i, int dst_lkt_i);
+        void _move_pawn(int color, int src_lkt_i, int dst_lkt_i, char promotion);
+        void _move_king(int color, int src_lkt_i, int dst_lkt_i, castle_info_e castle_info);
+        void _capture_piece(int dst_lkt_i);
+        void _add_piece_features(int piece, int lkt_i);
+        void _remove_piece_features(int piece, int lkt_i);
 
         void _update_engine_at_turn_end();
         void _update_engine_at_turn_start();
         void _update_check_and_pins();
-        void _update_pawn_check(int king_lkt_i);
+        void _update_en_passant_pins(int king_lkt_i);
         void _update_attacked_cells_masks();
-        void _update_fen_history();
-
-        void _find_white_pawns_attacks(uint64_t src);
-        void _find_white_knights_attacks(uint64_t src);
-        void _find_white_bishops_attacks(uint64_t src);
-        void _find_white_rooks_attacks(uint64_t src);
-        void _find_white_queens_attacks(uint64_t src);
-        void _find_white_king_attacks();
-        void _find_black_pawns_attacks(uint64_t src);
-        void _find_black_knights_attacks(uint64_t src);
-        void _find_black_bishops_attacks(uint64_t src);
-        void _find_black_rooks_attacks(uint64_t src);
-        void _find_black_queens_attacks(uint64_t src);
-        void _find_black_king_attacks();
+        void _update_position_history();
+
+        uint64_t _find_attacks(int color);
+        uint64_t _find_sliding_attacks(uint64_t sliders, uint64_t empty, int shift, uint64_t wrap);
 
         void _find_moves();
+        bool _has_legal_moves();
+        void _add_pseudo_legal_moves(vector<Move> *moves, char piece, uint64_t src, uint64_t dsts);
         void _find_white_pawns_moves(uint64_t src);
         void _find_white_knights_moves(uint64_t src);
         void _find_white_bishops_moves(uint64_t src);
         void _find_white_rooks_moves(uint64_t src);
         void _find_white_queens_moves(uint64_t src);
         void _find_white_king_moves();
-        void _find_white_castle_moves(uint64_t dst);
+        void _find_white_castle_moves(uint64_t dst, vector<Move> *moves);
         void _find_black_pawns_moves(uint64_t src);
         void _find_black_knights_moves(uint64_t src);
         void _find_black_bishops_moves(uint64_t src);
         void _find_black_rooks_moves(uint64_t src);
         void _find_black_queens_moves(uint64_t src);
         void _find_black_king_moves();
-        void _find_black_castle_moves(uint64_t dst);
+        void _find_black_castle_moves(uint64_t dst, vector<Move> *moves);
 
         void _add_regular_move_or_promotion(char piece, uint64_t src, uint64_t dst);
         void _create_piece_moves(char piece, uint64_t src, uint64_t legal_moves);
         void _create_move(char piece, uint64_t src, uint64_t dst, char promotion = 0);
 
         void _apply_function_on_all_pieces(uint64_t bitboard, std::function<void(uint64_t)> func);
+        inline uint64_t _get_pin_mask(int lkt_i)
+        {
+            return pinned_mask & (1UL << lkt_i) ? pin_masks[lkt_i] : BITMASK_ALL_CELLS;
+        }
         uint64_t _get_diagonal_rays(uint64_t src, uint64_t piece_to_ignore = 0UL);
         uint64_t _get_line_rays(uint64_t src, uint64_t piece_to_ignore = 0UL);
+        uint64_t _get_diagonal_attacks(int src_lkt_i, uint64_t occupancy);
+        uint64_t _get_line_attacks(int src_lkt_i, uint64_t occupancy);
         uint64_t
-        _compute_sliding_piece_positive_ray(uint64_t src, ray_dir_e dir, uint64_t piece_to_ignore);
+        _compute_sliding_piece_positive_ray(int src_lkt_i, ray_dir_e dir, uint64_t occupancy);
         uint64_t
-        _compute_sliding_piece_negative_ray(uint64_t src, ray_dir_e dir, uint64_t piece_to_ignore);
-        void _compute_sliding_piece_positive_ray_checks_and_pins(
-            uint64_t king_pos, ray_dir_e dir, uint64_t potential_attacker
-        );
-        void _compute_sliding_piece_negative_ray_checks_and_pins(
-            uint64_t king_pos, ray_dir_e dir, uint64_t potential_attacker
-        );
-        bool     _is_sliding_piece_positive_diagonal_ray_behind(uint64_t pawn_pos, ray_dir_e dir);
-        bool     _is_sliding_piece_negative_diagonal_ray_behind(uint64_t pawn_pos, ray_dir_e dir);
+        _compute_sliding_piece_negative_ray(int src_lkt_i, ray_dir_e dir, uint64_t occupancy);
         uint64_t _compute_castling_positive_path(uint64_t src, uint64_t dst);
         uint64_t _compute_castling_negative_path(uint64_t src, uint64_t dst);
 
@@ -453,17 +661,299 @@ class Board
         bool  _threefold_repetition_rule();
         bool  _insufficient_material_rule();
 
-        static bool     lookup_tables_initialized;
-        static uint64_t pawn_captures_lookup[64][2];
-        static uint64_t knight_lookup[64];
-        static uint64_t sliding_lookup[64][8];
-        static uint64_t king_lookup[64];
-
-        static void _initialize_lookup_tables();
-        static void _create_pawn_captures_lookup_table(int y, int x, uint64_t position, int lkt_i);
-        static void _create_knight_lookup_table(int y, int x, uint64_t position, int lkt_i);
-        static void _create_sliding_lookup_table(int y, int x, uint64_t position, int lkt_i);
-        static void _create_king_lookup_table(int y, int x, uint64_t position, int lkt_i);
+        static constexpr int see_piece_values[6] = {100, 305, 333, 563, 950, 20000};
+
+        // Generated at compile time, see Board.cpp
+        static const std::array<std::array<uint64_t, 2>, 64> pawn_captures_lookup;
+        static const std::array<uint64_t, 64>                knight_lookup;
+        static const std::array<std::array<uint64_t, 8>, 64> sliding_lookup;
+        static const std::array<uint64_t, 64>                king_lookup;
+        // Cells strictly between two aligned cells
+        static const std::array<std::array<uint64_t, 64>, 64> between_lookup;
+        // Pseudo-random keys by piece and cell, then castles, en passant and turn ones
+        static const std::array<std::array<uint64_t, 64>, 15> zobrist_lookup;
+
+        static constexpr std::array<std::array<uint64_t, 2>, 64>
+        _create_pawn_captures_lookup_table();
+        static constexpr std::array<uint64_t, 64>                _create_knight_lookup_table();
+        static constexpr std::array<std::array<uint64_t, 8>, 64> _create_sliding_lookup_table();
+        static constexpr std::array<uint64_t, 64>                _create_king_lookup_table();
+        static constexpr std::array<std::array<uint64_t, 64>, 64> _create_between_lookup_table();
+        static constexpr std::array<std::array<uint64_t, 64>, 15> _create_zobrist_lookup_table();
+};
+
+#endif
+
+/*
+        Content of 'srcs/datasets/MappedFile.hpp'
+*/
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Records buffered by RecordFileWriter before they're written to the file
+#define RECORD_FILE_BUFFER (1 << 12)
+
+template <typename T> class MappedFileReader
+{
+        /*
+        Read-only view of a file of fixed size records, which are used in place:
+        for (const PackedBoard &packed : MappedFileReader<PackedBoard>(path))
+            Board board(packed);
+        */
+
+    public:
+        MappedFileReader(string path)
+        {
+            this->_records = nullptr;
+            this->_size = 0;
+
+            int         fd = open(path.c_str(), O_RDONLY);
+            struct stat file_stat;
+            if (fd < 0 || fstat(fd, &file_stat) < 0)
+            {
+                cerr << "MappedFileReader: can't open " << path << endl;
+                if (fd >= 0)
+                    close(fd);
+                return;
+            }
+
+            // A truncated last record is ignored
+            this->_size = file_stat.st_size / sizeof(T);
+            if (this->_size)
+            {
+                void *data = mmap(nullptr, this->_size * sizeof(T), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                    this->_size = 0;
+                else
+                {
+                    this->_records = (const T *)data;
+                    madvise(data, this->_size * sizeof(T), MADV_SEQUENTIAL);
+                }
+            }
+            close(fd);
+        }
+
+        ~MappedFileReader()
+        {
+            if (this->_records)
+                munmap((void *)this->_records, this->_size * sizeof(T));
+        }
+
+        MappedFileReader(const MappedFileReader &) = delete;
+        MappedFileReader &operator=(const MappedFileReader &) = delete;
+
+        inline size_t size()
+        {
+            return _size;
+        }
+        inline const T &operator[](size_t i)
+        {
+            return _records[i];
+        }
+        inline const T *begin()
+        {
+            return _records;
+        }
+        inline const T *end()
+        {
+            return _records + _size;
+        }
+
+    private:
+        const T *_records;
+        size_t   _size;
+};
+
+template <typename T> class RecordFileWriter
+{
+        /*
+        Appends fixed size records to a file, through a buffer of RECORD_FILE_BUFFER records.
+        The file never holds more than the records written: if the process is killed, only the
+        buffered records are lost. A torn last record is dropped when the file is opened, so
+        that appends stay aligned. The file can be read back with MappedFileReader.
+        */
+
+    public:
+        RecordFileWriter(string path)
+        {
+            this->_size = 0;
+
+            this->_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            struct stat file_stat;
+            if (this->_fd < 0 || fstat(this->_fd, &file_stat) < 0)
+            {
+                cerr << "RecordFileWriter: can't open " << path << endl;
+                this->close();
+                return;
+            }
+
+            size_t size = file_stat.st_size / sizeof(T);
+            if ((off_t)(size * sizeof(T)) != file_stat.st_size &&
+                ftruncate(this->_fd, size * sizeof(T)) < 0)
+            {
+                cerr << "RecordFileWriter: can't truncate " << path << endl;
+                this->close();
+                return;
+            }
+            this->_size = size;
+            this->_buffer.reserve(RECORD_FILE_BUFFER);
+        }
+
+        ~RecordFileWriter()
+        {
+            this->close();
+        }
+
+        RecordFileWriter(const RecordFileWriter &) = delete;
+        RecordFileWriter &operator=(const RecordFileWriter &) = delete;
+
+        inline bool is_open()
+        {
+            return _fd >= 0;
+        }
+        // Records written, including the buffered ones
+        inline size_t size()
+        {
+            return _size + _buffer.size();
+        }
+
+        bool write(const T *records, size_t count)
+        {
+            if (!this->is_open())
+                return false;
+
+            if (this->_buffer.size() + count > RECORD_FILE_BUFFER && !this->flush())
+                return false;
+            if (count >= RECORD_FILE_BUFFER)
+                return this->_append(records, count);
+
+            this->_buffer.insert(this->_buffer.end(), records, records + count);
+            return true;
+        }
+
+        inline bool write(const T &record)
+        {
+            return write(&record, 1);
+        }
+
+        bool flush()
+        {
+            if (this->_buffer.empty())
+                return true;
+
+            bool written = this->_append(this->_buffer.data(), this->_buffer.size());
+            this->_buffer.clear();
+            return written;
+        }
+
+        void close()
+        {
+            if (this->_fd >= 0)
+            {
+                this->flush();
+                ::close(this->_fd);
+            }
+            this->_fd = -1;
+        }
+
+    private:
+        int       _fd;
+        size_t    _size;
+        vector<T> _buffer;
+
+        bool _append(const T *records, size_t count)
+        {
+            const char *data = (const char *)records;
+            size_t      left = count * sizeof(T);
+            off_t       offset = this->_size * sizeof(T);
+            while (left)
+            {
+                ssize_t written = pwrite(this->_fd, data, left, offset);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                {
+                    // Drops the torn record, if any, so that later appends stay aligned
+                    if (ftruncate(this->_fd, this->_size * sizeof(T)) < 0)
+                        cerr << "RecordFileWriter: can't truncate the file" << endl;
+                    cerr << "RecordFileWriter: can't write to the file" << endl;
+                    return false;
+                }
+                data += written;
+                left -= written;
+                offset += written;
+            }
+            this->_size += count;
+            return true;
+        }
+};
+
+#endif
+
+/*
+        Content of 'srcs/chessengine/MovePicker.hpp'
+*/
+
+#ifndef MOVEPICKER_HPP
+#define MOVEPICKER_HPP
+
+enum move_picker_stage_e
+{
+    HASH_MOVE_STAGE,
+    CAPTURES_STAGE,
+    KILLER_MOVES_STAGE,
+    QUIET_MOVES_STAGE,
+    LOSING_CAPTURES_STAGE,
+    END_STAGE
+};
+
+class MovePicker
+{
+        /*
+        Yields the legal moves of a board by stages : hash move, captures and promotions
+        (most valuable victim first), killer moves, quiet moves, then captures losing material.
+        Each stage is only generated once the previous ones are exhausted, and legality is only
+        checked for the moves actually yielded. With captures_only, losing captures are pruned.
+        */
+
+    public:
+        MovePicker(
+            Board        *board,
+            Move         *hash_move = nullptr,
+            vector<Move> *killer_moves = nullptr,
+            bool          captures_only = false
+        );
+
+        bool next_move(Move *move);
+        bool is_quiet_move_stage();
+
+        inline move_picker_stage_e get_stage()
+        {
+            return _stage;
+        }
+
+    private:
+        Board        *_board;
+        Move         *_hash_move;
+        vector<Move> *_killer_moves;
+        bool          _captures_only;
+
+        move_picker_stage_e _stage;
+        vector<Move>        _moves;
+        vector<Move>        _losing_captures;
+        vector<Move>        _yielded_moves;
+        size_t              _move_index;
+
+        void _sort_captures();
+        bool _is_already_yielded(Move &move);
+
+        static bool _is_same_move(Move &move, Move *other);
 };
 
 #endif
@@ -481,6 +971,23 @@ class AbstractHeuristic
     public:
         virtual float  evaluate(Board *board) = 0;
         virtual string get_name() = 0;
+
+        virtual vector<string> get_stats()
+        {
+            return vector<string>{};
+        };
+
+        // Appends the heuristic stats (e.g. cache hits) to the agent ones, and logs them all
+        void log_stats(const string &agent_version, vector<string> *stats)
+        {
+            for (string &stat : this->get_stats())
+                stats->push_back(stat);
+
+            cerr << agent_version << "\t: stats=";
+            for (string &stat : *stats)
+                cerr << stat << " ";
+            cerr << endl;
+        }
 };
 
 #endif
@@ -494,26 +1001,59 @@ class AbstractHeuristic
 
 #define EVALUATION_WINRATE_MAP_SIZE 40000
 
+// Entries count of the lossy caches, powers of 2 as they are indexed by the low bits of the keys
+#define EVALUATION_CACHE_SIZE (1 << 16)
+#define PAWN_CACHE_SIZE       (1 << 14)
+
 class PiecesHeuristic : public AbstractHeuristic
 {
 
     public:
         PiecesHeuristic();
 
-        float  evaluate(Board *board) override;
-        string get_name() override;
+        float          evaluate(Board *board) override;
+        string         get_name() override;
+        vector<string> get_stats() override;
 
     private:
-        float _evaluation_winrate_map[EVALUATION_WINRATE_MAP_SIZE];
+        static const std::array<float, EVALUATION_WINRATE_MAP_SIZE> _evaluation_winrate_map;
+
+        // Transpositions are frequent in both searches, an entry is replaced on each miss
+        struct EvaluationCacheEntry
+        {
+                uint64_t hash;
+                float    evaluation;
+        };
+        // Pawn structures change even less, their terms are cached by the pawns only key
+        struct PawnCacheEntry
+        {
+                uint64_t hash;
+                int      evaluation;
+        };
+
+        vector<EvaluationCacheEntry> _evaluation_cache;
+        vector<PawnCacheEntry>       _pawn_cache;
+
+        int _evaluation_cache_hits;
+        int _evaluation_cache_misses;
+        int _pawn_cache_hits;
+        int _pawn_cache_misses;
+
+        static constexpr std::array<float, EVALUATION_WINRATE_MAP_SIZE>
+        _create_evaluation_winrate_map();
 
         int _material_evaluation(Board *board, int *white_material, int *black_material);
         int _piece_positions_evaluation(
             Board *board, float white_eg_coefficient, float black_eg_coefficient
         );
 
-        int _lookup_bonuses_for_all_pieces(int *bonus_table, uint64_t bitboard);
+        float _compute_evaluation(Board *board);
+        int   _pawn_structure_evaluation(Board *board);
+        int   _pawn_structure_evaluation(uint64_t pawns, uint64_t enemy_pawns, int color);
+
+        int _lookup_bonuses_for_all_pieces(const int *bonus_table, uint64_t bitboard);
         int _lookup_bonuses_for_all_pieces(
-            int *sg_bonus_table, int *eg_bonus_table, float eg_coef, uint64_t bitboard
+            const int *sg_bonus_table, const int *eg_bonus_table, float eg_coef, uint64_t bitboard
         );
 
         typedef enum t_piece_values
@@ -529,13 +1069,18 @@ class PiecesHeuristic : public AbstractHeuristic
         const int control_value_for_enemy_cell = 10;
         const int control_value_for_ally_cell = 15;
 
+        const int doubled_pawn_penalty = 10;
+        const int isolated_pawn_penalty = 10;
+        // By rank, from the pawn's side
+        static constexpr int passed_pawn_bonus_table[8] = {0, 5, 10, 15, 25, 40, 60, 0};
+
         const int material_start_game =
             10 * PAWN_VALUE + 2 * KNIGHT_VALUE + 2 * BISHOP_VALUE + 2 * ROOK_VALUE + QUEEN_VALUE;
         const int material_end_game = QUEEN_VALUE + ROOK_VALUE + 3 * PAWN_VALUE;
         const int material_start_end_game_diff = material_start_game - material_end_game;
 
         // clang-format off
-                                int white_pawn_sg_bonus_table[64] = {
+        static constexpr int white_pawn_sg_bonus_table[64] = {
              0,  0,  0,  0,  0,  0,  0,  0,
             20, 20, 20, 20, 20, 20, 20, 20,
              0,  0,  0,  0,  0,  0,  0,  0,
@@ -546,7 +1091,7 @@ class PiecesHeuristic : public AbstractHeuristic
              0,  0,  0,  0,  0,  0,  0,  0
         };
 
-        int white_pawn_eg_bonus_table[64] = {
+        static constexpr int white_pawn_eg_bonus_table[64] = {
              0,  0,  0,  0,  0,  0,  0,  0,
             80, 80, 80, 80, 80, 80, 80, 80,
             50, 50, 50, 50, 50, 50, 50, 50,
@@ -557,7 +1102,7 @@ class PiecesHeuristic : public AbstractHeuristic
              0,  0,  0,  0,  0,  0,  0,  0,
         };
         
-        int black_pawn_sg_bonus_table[64] = {
+        static constexpr int black_pawn_sg_bonus_table[64] = {
              0,  0,  0,  0,  0,  0,  0,  0,
              5,  5, 5, -20,-20,  5,  5,  5,
              0,  0, 10,  0,  0, 10,  0,  0,
@@ -568,7 +1113,7 @@ class PiecesHeuristic : public AbstractHeuristic
              0,  0,  0,  0,  0,  0,  0,  0
         };
 
-        int black_pawn_eg_bonus_table[64] = {
+        static constexpr int black_pawn_eg_bonus_table[64] = {
              0,  0,  0,  0,  0,  0,  0,  0,
             10, 10, 10, 10, 10, 10, 10, 10,
             10, 10, 10, 10, 10, 10, 10, 10,
@@ -579,7 +1124,7 @@ class PiecesHeuristic : public AbstractHeuristic
              0,  0,  0,  0,  0,  0,  0,  0
         };
 
-        int white_knight_bonus_table[64] = {
+        static constexpr int white_knight_bonus_table[64] = {
             -20,-20,-10,-10,-10,-10,-20,-20,
             -20,-20,  0,  5,  5,  0,-20,-20,
             -10,  5, 10, 15, 15, 10,  5,-10,
@@ -590,7 +1135,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -20,-20,-10,-10,-10,-10,-20,-20
         };
 
-        int black_knight_bonus_table[64] = {
+        static constexpr int black_knight_bonus_table[64] = {
             -50,-40,-30,-30,-30,-30,-40,-50,
             -40,-20,  0,  0,  0,  0,-20,-40,
             -30,  5, 10, 15, 15, 10,  5,-30,
@@ -601,7 +1146,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -50,-40,-30,-30,-30,-30,-40,-50,
         };
 
-        int white_bishop_bonus_table[64] = {
+        static constexpr int white_bishop_bonus_table[64] = {
             -20,-10,-10,-10,-10,-10,-10,-20,
             -10,  0,  0,  0,  0,  0,  0,-10,
             -10,  0,  5,  5,  5,  5,  0,-10,
@@ -612,7 +1157,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -20,-10,-10,-10,-10,-10,-10,-20
         };
 
-        int black_bishop_bonus_table[64] = {
+        static constexpr int black_bishop_bonus_table[64] = {
             -20,-10,-10,-10,-10,-10,-10,-20,
             -10,  0,  0,  0,  0,  0,  0,-10,
             -10,  0,  5,  5,  5,  5,  0,-10,
@@ -623,7 +1168,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -20,-10,-10,-10,-10,-10,-10,-20
         };
 
-        int white_rook_bonus_table[64] = {
+        static constexpr int white_rook_bonus_table[64] = {
              0,  0,  0,  0,  0,  0,  0,  0,
              5, 10, 10, 10, 10, 10, 10,  5,
             -5,  0,  0,  0,  0,  0,  0, -5,
@@ -634,7 +1179,7 @@ class PiecesHeuristic : public AbstractHeuristic
              0,  0, 10, 10, 10, 10,  0,  0
         };
 
-        int black_rook_bonus_table[64] = {
+        static constexpr int black_rook_bonus_table[64] = {
              0,  0, 10, 10, 10, 10,  0,  0,
             -5,  0,  0,  0,  0,  0,  0, -5,
             -5,  0,  0,  0,  0,  0,  0, -5,
@@ -645,7 +1190,7 @@ class PiecesHeuristic : public AbstractHeuristic
              0,  0,  0,  0,  0,  0,  0,  0,
         };
 
-        int white_queen_bonus_table[64] = {
+        static constexpr int white_queen_bonus_table[64] = {
             -20,-10,-10, -5, -5,-10,-10,-20,
             -10,  0,  0,  0,  0,  0,  0,-10,
             -10,  0, 10, 10, 10, 10,  0,-10,
@@ -656,7 +1201,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -20,-10,-10, -5, -5,-10,-10,-20
         };
 
-        int black_queen_bonus_table[64] = {
+        static constexpr int black_queen_bonus_table[64] = {
             -20,-10,-10, -5, -5,-10,-10,-20,
             -10,  0,  5,  0,  0,  0,  0,-10,
             -10,  0, 10, 10, 10, 10,  0,-10,
@@ -667,7 +1212,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -20,-10,-10, -5, -5,-10,-10,-20
         };
  
-        int white_king_sg_bonus_table[64] = {
+        static constexpr int white_king_sg_bonus_table[64] = {
             -60,-60,-60,-60,-60,-60,-60,-60,
             -50,-50,-50,-50,-50,-50,-50,-50,
             -40,-40,-40,-40,-40,-40,-40,-40,
@@ -678,7 +1223,7 @@ class PiecesHeuristic : public AbstractHeuristic
               5,  5, 30,  0,  0,  0, 30,  5
         };
 
-        int white_king_eg_bonus_table[64] = {
+        static constexpr int white_king_eg_bonus_table[64] = {
             -50,-40,-20,-20,-20,-20,-40,-50,
             -40,-20,  0,  0,  0,  0,-20,-40,
             -20,  0,  5,  5,  5,  5,  0,-20,
@@ -689,7 +1234,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -50,-40,-20,-20,-20,-20,-40,-50
         };
 
-        int black_king_sg_bonus_table[64] = {
+        static constexpr int black_king_sg_bonus_table[64] = {
               5,  5, 30,  0,  0,  0, 30,  5,
               0,  0,  0,  0,  0,  0,  0,  0,
             -10,-10,-10,-10,-10,-10,-10,-10,
@@ -700,7 +1245,7 @@ class PiecesHeuristic : public AbstractHeuristic
             -60,-60,-60,-60,-60,-60,-60,-60,
         };
 
-        int black_king_eg_bonus_table[64] = {
+        static constexpr int black_king_eg_bonus_table[64] = {
             -50,-40,-20,-20,-20,-20,-40,-50,
             -40,-20,  0,  0,  0,  0,-20,-40,
             -20,  0,  5,  5,  5,  5,  0,-20,
@@ -716,26 +1261,50 @@ class PiecesHeuristic : public AbstractHeuristic
 #endif
 
 /*
-        Content of 'srcs/agents/AbstractAgent.hpp'
+        Content of 'srcs/heuristics/NnueHeuristic.hpp'
 */
 
-#ifndef ABSTRACTAGENT_HPP
-#define ABSTRACTAGENT_HPP
+#ifndef NNUEHEURISTIC_HPP
+#define NNUEHEURISTIC_HPP
 
-#include <tuple>
-#include <vector>
+#if USE_NNUE == 1
 
-class AbstractAgent
+class NnueHeuristic : public AbstractHeuristic
 {
+        /*
+        Evaluation by the network of Nnue.hpp, whose first layer is already computed by the board.
+        */
 
     public:
-        virtual void get_qualities(Board *board, vector<Move> moves, vector<float> *qualities) = 0;
-        virtual string get_name() = 0;
-
-        virtual vector<string> get_stats()
-        {
-            return vector<string>{};
-        };
+        float  evaluate(Board *board) override;
+        string get_name() override;
+};
+
+#endif
+
+#endif
+
+/*
+        Content of 'srcs/agents/AbstractAgent.hpp'
+*/
+
+#ifndef ABSTRACTAGENT_HPP
+#define ABSTRACTAGENT_HPP
+
+#include <tuple>
+#include <vector>
+
+class AbstractAgent
+{
+
+    public:
+        virtual void get_qualities(Board *board, vector<Move> moves, vector<float> *qualities) = 0;
+        virtual string get_name() = 0;
+
+        virtual vector<string> get_stats()
+        {
+            return vector<string>{};
+        };
 };
 
 #endif
@@ -786,7 +1355,7 @@ class MctsAgent : public AbstractAgent
         virtual string get_name() override;
         vector<string> get_stats() override;
 
-    private:
+    protected:
         AbstractHeuristic *_heuristic;
         float              _exploration_constant;
 
@@ -810,6 +1379,9 @@ class MctsAgent : public AbstractAgent
         float mcts(Node *node, int depth);
         Node *select_child(Node *node);
         void  expand_node(Node *node);
+        void  solve_node(Node *node);
+
+        virtual float simulation(Node *node);
 
         bool  is_time_up();
         float elapsed_time(clock_t clock_start);
@@ -817,6 +1389,145 @@ class MctsAgent : public AbstractAgent
 
 #endif
 
+/*
+        Content of 'srcs/agents/MinMaxAlphaBetaAgent.hpp'
+*/
+
+#ifndef MINMAXITERDEEPAGENT_HPP
+#define MINMAXITERDEEPAGENT_HPP
+
+// Selective search techniques, each one can be turned off to be compared in the league
+#ifndef MMAB_NULL_MOVE_PRUNING
+#define MMAB_NULL_MOVE_PRUNING 1
+#endif
+#ifndef MMAB_LATE_MOVE_REDUCTIONS
+#define MMAB_LATE_MOVE_REDUCTIONS 1
+#endif
+#ifndef MMAB_FUTILITY_PRUNING
+#define MMAB_FUTILITY_PRUNING 1
+#endif
+
+#define MMAB_NULL_MOVE_MIN_DEPTH 3
+#define MMAB_NULL_MOVE_REDUCTION 2
+#define MMAB_LMR_MIN_DEPTH       3
+#define MMAB_LMR_MIN_MOVE_INDEX  3
+// Margins in centipawns, see add_centipawns()
+#define MMAB_FUTILITY_MARGIN 200
+#define MMAB_RAZORING_MARGIN 300
+// Half width of the first root window around the previous iteration's score
+#define MMAB_ASPIRATION_WINDOW     50
+#define MMAB_ASPIRATION_FULL_WIDTH 2000
+
+class MinMaxAlphaBetaAgent : public AbstractAgent
+{
+        /*
+        Iterative deepening negamax, with principal variation search: after the first one,
+        moves are searched with a null window and only searched again with the full one
+        when they fail high. Scores are from the point of view of the side to move.
+        */
+
+    public:
+        MinMaxAlphaBetaAgent(AbstractHeuristic *heuristic, int ms_constraint);
+        virtual void
+        get_qualities(Board *board, vector<Move> moves, vector<float> *qualities) override;
+        virtual string get_name() override;
+        vector<string> get_stats() override;
+
+        float search(Board *board, int max_depth, int nodes_limit, clock_t start_time);
+
+        inline int get_nodes_explored()
+        {
+            return _nodes_explored;
+        }
+
+        // Limits each get_qualities() call, on top of the time constraint
+        inline void set_nodes_budget(int nodes_budget)
+        {
+            _nodes_budget = nodes_budget;
+        }
+
+    private:
+        AbstractHeuristic *_heuristic;
+
+        int     _ms_constraint;
+        float   _ms_turn_stop;
+        clock_t _start_time;
+
+        int _depth_reached;
+        int _nodes_explored;
+        int _nodes_limit;
+        int _nodes_budget;
+
+        // Last quiet moves which produced a cutoff, per depth
+        vector<vector<Move>> _killer_moves;
+        // Triangular table: best line found from each depth, the root one being the PV
+        vector<vector<Move>> _pv_table;
+        vector<Move>         _principal_variation;
+        // Whether the current path still follows the previous iteration's PV
+        bool _follow_pv;
+
+        float root_search(
+            Board *board, vector<Move> *moves, int max_depth, float alpha, float beta,
+            vector<float> *scores
+        );
+        float negamax(
+            Board *board, int max_depth, int depth, float alpha, float beta,
+            bool null_move_allowed = true
+        );
+        float quiescence(Board *board, float alpha, float beta);
+        float search_move(
+            Board *board, int max_depth, int depth, float alpha, float beta, int reduction
+        );
+        float evaluate(Board *board);
+        bool  has_non_pawn_material(Board *board);
+        float add_centipawns(float evaluation, float centipawns);
+        void  store_killer_move(Move move, int depth);
+        void  update_principal_variation(Move move, int depth);
+        void  prepare_tables(int max_depth);
+
+        bool  is_time_up();
+        float elapsed_time();
+};
+
+#endif
+
+/*
+        Content of 'srcs/agents/MctsAlphaBetaAgent.hpp'
+*/
+
+#ifndef MCTSALPHABETAAGENT_HPP
+#define MCTSALPHABETAAGENT_HPP
+
+// Lowest MCTS iterations count per turn the leaf searches depth is adapted to
+#define MCTS_AB_MIN_ITERATIONS 200
+
+class MctsAlphaBetaAgent : public MctsAgent
+{
+    public:
+        MctsAlphaBetaAgent(AbstractHeuristic *heuristic, int ms_constraint);
+        virtual void
+        get_qualities(Board *board, vector<Move> moves, vector<float> *qualities) override;
+        virtual string get_name() override;
+        vector<string> get_stats() override;
+
+    private:
+        MinMaxAlphaBetaAgent *_alpha_beta;
+
+        int   _leaf_depth;
+        float _ms_per_leaf;
+        float _nodes_per_ms;
+
+        int     _leaf_searches;
+        int     _leaf_nodes;
+        int     _leaf_children;
+        clock_t _leaf_clock;
+
+        float simulation(Node *node) override;
+        void  adapt_leaf_depth();
+};
+
+#endif
+
 /*
         Content of 'srcs/players/AbstractPlayer.hpp'
 */
@@ -862,6 +1573,74 @@ class BotPlayer : public AbstractPlayer
 
 #endif
 
+/*
+        Content of 'srcs/selfplay/SelfPlayGenerator.hpp'
+*/
+
+#ifndef SELFPLAYGENERATOR_HPP
+#define SELFPLAYGENERATOR_HPP
+
+#if SELFPLAY == 1
+
+// clock() counts the CPU time of all threads: moves are only limited by their nodes budget
+#define SELFPLAY_MS_CONSTRAINT 100000000
+// Scores of decided positions, in centipawns
+#define SELFPLAY_MATE_SCORE 32000
+
+struct SelfPlayRecord
+{
+        PackedBoard board;
+        int16_t     score;  // Search score in centipawns, from white's point of view
+        int8_t      result; // From white's point of view: 1, 0 or -1
+        uint8_t     reserved[5];
+};
+
+static_assert(sizeof(SelfPlayRecord) == 40, "SelfPlayRecord must stay packed");
+
+class SelfPlayGenerator
+{
+        /*
+        Plays games between copies of MinMaxAlphaBetaAgent on several threads, from random
+        Chess960 starts followed by a few random moves. The positions searched during the
+        games, except the ones in check, are appended to the output file once each game ends.
+        They can be read back with MappedFileReader<SelfPlayRecord>.
+        */
+
+    public:
+        SelfPlayGenerator(
+            string output_path, int threads_count, int nodes_per_move, int random_plies,
+            unsigned int seed
+        );
+
+        bool run(int games_count);
+
+    private:
+        string                            _output_path;
+        RecordFileWriter<SelfPlayRecord> *_output;
+        std::mutex                        _output_mutex;
+        int          _threads_count;
+        int          _nodes_per_move;
+        int          _random_plies;
+        unsigned int _seed;
+
+        std::atomic<int>  _games_started;
+        std::atomic<int>  _games_played;
+        std::atomic<long> _positions_written;
+
+        std::chrono::steady_clock::time_point _start_time;
+
+        void   _worker(int worker_index, int games_count);
+        void   _play_game(std::mt19937 *rng, MinMaxAlphaBetaAgent *agent);
+        void   _write_records(vector<SelfPlayRecord> &records);
+        string _create_random_chess960_fen(std::mt19937 *rng);
+
+        SelfPlayRecord _create_record(Board *board, float score);
+};
+
+#endif
+
+#endif
+
 /*
         Content of 'srcs/gameengine/GameEngine.hpp'
 */
@@ -999,12 +1778,6 @@ void GameEngine::_parse_turn()
         Content of 'srcs/chessengine/Board.cpp'
 */
 
-bool     Board::lookup_tables_initialized = false;
-uint64_t Board::pawn_captures_lookup[64][2];
-uint64_t Board::knight_lookup[64];
-uint64_t Board::sliding_lookup[64][8];
-uint64_t Board::king_lookup[64];
-
 Board::Board()
 {
 }
@@ -1049,13 +1822,46 @@ Board::Board(
     );
 }
 
+Board::Board(const PackedBoard &packed, bool _chess960_rule, bool _codingame_rule)
+{
+    chess960_rule = _chess960_rule;
+    codingame_rule = _codingame_rule;
+
+    _initialize_bitboards();
+
+    uint64_t occupancy = packed.occupancy;
+    for (int i = 0; occupancy; i++)
+    {
+        int lkt_i = _count_trailing_zeros(occupancy);
+        int piece = packed.pieces[i / 2] >> (i % 2 * 4) & 0xF;
+
+        bitboards[piece / 6][piece % 6] |= 1UL << lkt_i;
+        piece_on[lkt_i] = piece;
+        _add_piece_features(piece, lkt_i);
+
+        occupancy &= occupancy - 1;
+    }
+
+    white_turn = packed.white_turn;
+    castles[WHITE] = (uint64_t)packed.castling_files[WHITE] << 56;
+    castles[BLACK] = packed.castling_files[BLACK];
+    // The en passant cell is behind the pawn which just moved, on the 6th or 3rd rank
+    if (packed.en_passant_file < 8)
+        en_passant = 1UL << ((white_turn ? 16 : 40) + packed.en_passant_file);
+    next_turn_en_passant = 0UL;
+    half_turn_rule = packed.half_turn_rule;
+    game_turn = packed.game_turn;
+
+    _initialize_engine_data();
+}
+
 void Board::log(bool raw)
 {
     uint64_t rook;
 
     string   white_castles_pos[2] = {"N/A", "N/A"};
     int      white_castles_pos_i = 0;
-    uint64_t castle_tmp = white_castles;
+    uint64_t castle_tmp = castles[WHITE];
     while (castle_tmp)
     {
         rook = _get_least_significant_bit(castle_tmp);
@@ -1066,7 +1872,7 @@ void Board::log(bool raw)
 
     string black_castles_pos[2] = {"N/A", "N/A"};
     int    black_castles_pos_i = 0;
-    castle_tmp = black_castles;
+    castle_tmp = castles[BLACK];
     while (castle_tmp)
     {
         rook = _get_least_significant_bit(castle_tmp);
@@ -1101,54 +1907,37 @@ void Board::apply_move(Move move)
     if (!this->engine_data_updated)
         _update_engine_at_turn_start();
 
-    char piece = move.piece == EMPTY_CELL ? _get_cell(move.src) : move.piece;
-    if (piece == 'P')
-        _move_white_pawn(move.src, move.dst, move.promotion);
-    else if (piece == 'N')
-        _apply_regular_white_move(move.src, move.dst, &white_knights);
-    else if (piece == 'B')
-        _apply_regular_white_move(move.src, move.dst, &white_bishops);
-    else if (piece == 'R')
-    {
-        _apply_regular_white_move(move.src, move.dst, &white_rooks);
+    int src_lkt_i = _count_trailing_zeros(move.src);
+    int dst_lkt_i = _count_trailing_zeros(move.dst);
+    int piece = piece_on[src_lkt_i];
+    int color = piece / 6;
+    int type = piece % 6;
 
-        white_castles &= ~move.src;
-    }
-    else if (piece == 'Q')
-        _apply_regular_white_move(move.src, move.dst, &white_queens);
-    else if (piece == 'K')
-        _move_white_king(move.src, move.dst, move.castle_info);
-    else if (piece == 'p')
-        _move_black_pawn(move.src, move.dst, move.promotion);
-    else if (piece == 'n')
-        _apply_regular_black_move(move.src, move.dst, &black_knights);
-    else if (piece == 'b')
-        _apply_regular_black_move(move.src, move.dst, &black_bishops);
-    else if (piece == 'r')
+    if (type == PAWN)
+        _move_pawn(color, src_lkt_i, dst_lkt_i, move.promotion);
+    else if (type == KING)
+        _move_king(color, src_lkt_i, dst_lkt_i, move.castle_info);
+    else
     {
-        _apply_regular_black_move(move.src, move.dst, &black_rooks);
+        _apply_regular_move(color, type, src_lkt_i, dst_lkt_i);
 
-        black_castles &= ~move.src;
+        castles[color] &= ~move.src;
     }
-    else if (piece == 'q')
-        _apply_regular_black_move(move.src, move.dst, &black_queens);
-    else if (piece == 'k')
-        _move_black_king(move.src, move.dst, move.castle_info);
 
 #if USE_VISUAL_BOARD == 1
     this->visual_board.resetBoard();
-    this->visual_board.updateBoard('P', white_pawns);
-    this->visual_board.updateBoard('N', white_knights);
-    this->visual_board.updateBoard('B', white_bishops);
-    this->visual_board.updateBoard('R', white_rooks);
-    this->visual_board.updateBoard('Q', white_queens);
-    this->visual_board.updateBoard('K', white_king);
-    this->visual_board.updateBoard('p', black_pawns);
-    this->visual_board.updateBoard('n', black_knights);
-    this->visual_board.updateBoard('b', black_bishops);
-    this->visual_board.updateBoard('r', black_rooks);
-    this->visual_board.updateBoard('q', black_queens);
-    this->visual_board.updateBoard('k', black_king);
+    this->visual_board.updateBoard('P', white_pawns());
+    this->visual_board.updateBoard('N', white_knights());
+    this->visual_board.updateBoard('B', white_bishops());
+    this->visual_board.updateBoard('R', white_rooks());
+    this->visual_board.updateBoard('Q', white_queens());
+    this->visual_board.updateBoard('K', white_king());
+    this->visual_board.updateBoard('p', black_pawns());
+    this->visual_board.updateBoard('n', black_knights());
+    this->visual_board.updateBoard('b', black_bishops());
+    this->visual_board.updateBoard('r', black_rooks());
+    this->visual_board.updateBoard('q', black_queens());
+    this->visual_board.updateBoard('k', black_king());
 
     if (PRINT_TURNS)
         this->visual_board.printBoard();
@@ -1178,16 +1967,61 @@ bool Board::get_check_state()
     return this->check_state;
 }
 
-char Board::get_cell(int x, int y)
+uint64_t Board::get_attacked_cells_mask(int color)
 {
-    uint64_t pos_mask = 1UL << (y * 8 + x);
+    if (!this->engine_data_updated)
+        _update_engine_at_turn_start();
+
+    // Only the enemy map is needed by move generation, the ally one is built on demand
+    if (color == (white_turn ? WHITE : BLACK) && !this->ally_attacked_cells_computed)
+    {
+        attacked_by_masks[color] = _find_attacks(color);
+        this->ally_attacked_cells_computed = true;
+    }
+
+    return attacked_by_masks[color];
+}
 
-    return _get_cell(pos_mask);
+char Board::get_cell(int x, int y)
+{
+    return index_to_piece(piece_on[y * 8 + x]);
 }
 
 uint64_t Board::get_castling_rights()
 {
-    return white_castles | black_castles;
+    return castles[WHITE] | castles[BLACK];
+}
+
+uint64_t Board::get_hash()
+{
+    // Castles and en passant are hashed by their cell, they are few enough to be added on demand
+    uint64_t hash = white_turn ? pieces_hash : pieces_hash ^ zobrist_lookup[ZOBRIST_BLACK_TURN][0];
+
+    uint64_t castling_rights = castles[WHITE] | castles[BLACK];
+    while (castling_rights)
+    {
+        hash ^= zobrist_lookup[ZOBRIST_CASTLES][_count_trailing_zeros(castling_rights)];
+        castling_rights &= castling_rights - 1;
+    }
+
+    if (en_passant)
+        hash ^= zobrist_lookup[ZOBRIST_EN_PASSANT][_count_trailing_zeros(en_passant)];
+
+    return hash;
+}
+
+void Board::apply_null_move()
+{
+    // The side to move passes: only the turn and the en passant right change, the hash follows
+    // from them. The move counters and the position history are kept, so a null move can't
+    // produce a draw by the 50 moves rule, the turn limit or repetition
+    moves_computed = false;
+    game_state_computed = false;
+    engine_data_updated = false;
+
+    en_passant = 0UL;
+    next_turn_en_passant = 0UL;
+    white_turn = !white_turn;
 }
 
 vector<Move> Board::get_available_moves()
@@ -1203,101 +2037,362 @@ vector<Move> Board::get_available_moves()
     return this->available_moves;
 }
 
-string Board::get_name()
+void Board::find_pseudo_legal_moves(vector<Move> *moves, bool captures)
 {
-    return "BitBoard";
-}
+    if (!this->engine_data_updated)
+        _update_engine_at_turn_start();
 
-string Board::create_fen(bool with_turns)
-{
-    char fen[85];
-    int  fen_i = 0;
+    int             ally = white_turn ? WHITE : BLACK;
+    const uint64_t *pieces = bitboards[ally];
+    const char     *piece_chars = ally == WHITE ? "PNBRQK" : "pnbrqk";
 
-    bzero(fen, 85);
+    // Promotions are generated with captures, king moves are checked against attacks when tried
+    uint64_t king_targets = captures ? pieces_masks[!ally] : empty_cells_mask;
+    if (pieces[KING])
+        _add_pseudo_legal_moves(
+            moves, piece_chars[KING], pieces[KING],
+            king_lookup[_count_trailing_zeros(pieces[KING])] & king_targets
+        );
 
-    int empty_cells_count = 0;
-    for (int y = 0; y < 8; y++)
+    if (double_check)
+        return;
+
+    uint64_t targets = king_targets & uncheck_mask;
+    uint64_t pawns = pieces[PAWN];
+    while (pawns)
     {
-        for (int x = 0; x < 8; x++)
+        uint64_t src = _get_least_significant_bit(pawns);
+        int      src_lkt_i = _count_trailing_zeros(src);
+        uint64_t push = (ally == WHITE ? src >> 8 : src << 8) & empty_cells_mask;
+        uint64_t dsts;
+
+        if (captures)
+            dsts = (pawn_captures_lookup[src_lkt_i][ally] & (pieces_masks[!ally] | en_passant)) |
+                   (push & BITMASK_LINE_81);
+        else
         {
-            if (get_cell(x, y) == EMPTY_CELL)
-            {
-                empty_cells_count++;
-                continue;
-            }
-
-            if (empty_cells_count > 0)
-            {
-                fen[fen_i++] = '0' + empty_cells_count;
-                empty_cells_count = 0;
-            }
-
-            fen[fen_i++] = get_cell(x, y);
+            dsts = push & ~BITMASK_LINE_81;
+            if (push && (src & (ally == WHITE ? BITMASK_LINE_2 : BITMASK_LINE_7)))
+                dsts |= (ally == WHITE ? src >> 16 : src << 16) & empty_cells_mask;
         }
+        _add_pseudo_legal_moves(moves, piece_chars[PAWN], src, dsts & pawn_uncheck_mask);
 
-        if (empty_cells_count > 0)
+        pawns ^= src;
+    }
+
+    for (int type = KNIGHT; type <= QUEEN; type++)
+    {
+        uint64_t type_pieces = pieces[type];
+        while (type_pieces)
         {
-            fen[fen_i++] = '0' + empty_cells_count;
-            empty_cells_count = 0;
+            uint64_t src = _get_least_significant_bit(type_pieces);
+            int      src_lkt_i = _count_trailing_zeros(src);
+            uint64_t dsts = 0UL;
+
+            if (type == KNIGHT)
+                dsts = knight_lookup[src_lkt_i];
+            if (type == BISHOP || type == QUEEN)
+                dsts |= _get_diagonal_attacks(src_lkt_i, all_pieces_mask);
+            if (type == ROOK || type == QUEEN)
+                dsts |= _get_line_attacks(src_lkt_i, all_pieces_mask);
+            _add_pseudo_legal_moves(moves, piece_chars[type], src, dsts & targets);
+
+            type_pieces ^= src;
         }
-
-        if (y != 7)
-            fen[fen_i++] = '/';
     }
-    fen[fen_i++] = ' ';
-
-    fen[fen_i++] = white_turn ? 'w' : 'b';
-    fen[fen_i++] = ' ';
 
-    if (white_castles || black_castles)
+    if (!captures)
     {
-        if (this->chess960_rule)
-            _create_fen_for_chess960_castling(fen, &fen_i);
+        if (white_turn)
+            _apply_function_on_all_pieces(castles[WHITE], [this, moves](uint64_t param) {
+                _find_white_castle_moves(param, moves);
+            });
         else
-            _create_fen_for_standard_castling(fen, &fen_i);
+            _apply_function_on_all_pieces(castles[BLACK], [this, moves](uint64_t param) {
+                _find_black_castle_moves(param, moves);
+            });
     }
-    else
-        fen[fen_i++] = '-';
-    fen[fen_i++] = ' ';
+}
 
-    if (en_passant)
+bool Board::is_pseudo_legal_move(Move &move)
+{
+    /*
+        Moves from other positions, like killer or hash moves, must be checked before being
+        tried. Castles are left to the regular generation.
+    */
+    if (!this->engine_data_updated)
+        _update_engine_at_turn_start();
+
+    if (!move.src || !move.dst)
+        return false;
+
+    int ally = white_turn ? WHITE : BLACK;
+    int src_lkt_i = _count_trailing_zeros(move.src);
+    int piece = piece_on[src_lkt_i];
+
+    if (piece == NO_PIECE || piece / 6 != ally || move.castle_info > NOTCASTLE ||
+        (move.dst & pieces_masks[ally]))
+        return false;
+
+    int type = piece % 6;
+    if (type == KING)
+        return king_lookup[src_lkt_i] & move.dst;
+    if (double_check)
+        return false;
+
+    if (type == PAWN)
     {
-        string en_passant_str = bitboard_to_algebraic(en_passant);
-        fen[fen_i++] = en_passant_str[0];
-        fen[fen_i++] = en_passant_str[1];
-    }
-    else
-        fen[fen_i++] = '-';
-    fen[fen_i++] = ' ';
+        uint64_t push = (ally == WHITE ? move.src >> 8 : move.src << 8) & empty_cells_mask;
+        uint64_t dsts = pawn_captures_lookup[src_lkt_i][ally] & (pieces_masks[!ally] | en_passant);
 
-    string fen_string = string(fen, fen_i);
+        dsts |= push;
+        if (push && (move.src & (ally == WHITE ? BITMASK_LINE_2 : BITMASK_LINE_7)))
+            dsts |= (ally == WHITE ? move.src >> 16 : move.src << 16) & empty_cells_mask;
 
-    if (!with_turns)
-        return fen_string;
+        return (dsts & move.dst & pawn_uncheck_mask) &&
+               ((move.dst & BITMASK_LINE_81) != 0UL) == (move.promotion != 0);
+    }
 
-    fen_string += to_string(half_turn_rule);
-    fen_string += string(" ");
+    uint64_t dsts = 0UL;
+    if (type == KNIGHT)
+        dsts = knight_lookup[src_lkt_i];
+    if (type == BISHOP || type == QUEEN)
+        dsts |= _get_diagonal_attacks(src_lkt_i, all_pieces_mask);
+    if (type == ROOK || type == QUEEN)
+        dsts |= _get_line_attacks(src_lkt_i, all_pieces_mask);
 
-    fen_string += to_string(game_turn);
+    return !move.promotion && (dsts & move.dst & uncheck_mask);
+}
 
-    return fen_string;
+bool Board::is_capture_move(Move &move)
+{
+    int piece = piece_on[_count_trailing_zeros(move.src)];
+
+    return move.castle_info <= NOTCASTLE &&
+           ((move.dst & all_pieces_mask) || (move.dst == en_passant && piece % 6 == PAWN));
 }
 
-Board *Board::clone()
+bool Board::is_legal_move(Move &move)
 {
-    Board *cloned_board = new Board();
+    if (!this->engine_data_updated)
+        _update_engine_at_turn_start();
 
-    *cloned_board = *this;
+    // Castles are only generated when legal
+    if (move.src & ally_king)
+        return move.castle_info > NOTCASTLE ||
+               !(move.dst & get_attacked_cells_mask(white_turn ? BLACK : WHITE));
 
-    return cloned_board;
+    return !(move.src & pinned_mask) || (move.dst & pin_masks[_count_trailing_zeros(move.src)]);
 }
 
-void Board::_main_parsing(
-    string _board,
-    string _color,
-    string _castling,
-    string _en_passant,
-    int    _half_turn_rule,
+int Board::see(Move &move)
+{
+    /*
+        Swap algorithm: both sides alternately recapture on the destination cell with
+        their least valuable attacker, sliders behind the removed pieces joining in.
+        Each side can stop capturing once it would lose material by going on.
+    */
+    if (!this->engine_data_updated)
+        _update_engine_at_turn_start();
+
+    if (move.castle_info > NOTCASTLE)
+        return 0;
+
+    int src_lkt_i = _count_trailing_zeros(move.src);
+    int dst_lkt_i = _count_trailing_zeros(move.dst);
+    int attacker_type = piece_on[src_lkt_i] % 6;
+    int victim = piece_on[dst_lkt_i];
+
+    int      gain[32];
+    uint64_t occupancy = all_pieces_mask ^ move.src;
+    gain[0] = victim == NO_PIECE ? 0 : see_piece_values[victim % 6];
+
+    if (attacker_type == PAWN && move.dst == en_passant)
+    {
+        gain[0] = see_piece_values[PAWN];
+        occupancy ^= white_turn ? en_passant << 8 : en_passant >> 8;
+    }
+    if (move.promotion)
+    {
+        attacker_type = piece_to_index(tolower(move.promotion)) % 6;
+        gain[0] += see_piece_values[attacker_type] - see_piece_values[PAWN];
+    }
+
+    uint64_t attackers = attackers_to(dst_lkt_i, occupancy) & occupancy;
+    int      color = white_turn ? BLACK : WHITE;
+    int      depth = 0;
+    while (depth < 31)
+    {
+        uint64_t color_attackers = attackers & pieces_masks[color];
+        if (!color_attackers)
+            break;
+
+        // Gain of the side recapturing, before knowing whether it is recaptured in turn
+        depth++;
+        gain[depth] = see_piece_values[attacker_type] - gain[depth - 1];
+
+        for (attacker_type = PAWN; attacker_type <= KING; attacker_type++)
+            if (color_attackers & bitboards[color][attacker_type])
+                break;
+
+        occupancy ^= _get_least_significant_bit(color_attackers & bitboards[color][attacker_type]);
+        attackers = attackers_to(dst_lkt_i, occupancy) & occupancy;
+        color = !color;
+    }
+
+    // Each side picks between standing pat and recapturing
+    for (; depth > 0; depth--)
+        gain[depth - 1] = -max(-gain[depth - 1], gain[depth]);
+
+    return gain[0];
+}
+
+bool Board::see_ge(Move &move, int threshold)
+{
+    if (!this->engine_data_updated)
+        _update_engine_at_turn_start();
+
+    // Most captures are settled without running the exchange
+    if (!move.promotion && move.castle_info <= NOTCASTLE)
+    {
+        int victim = piece_on[_count_trailing_zeros(move.dst)];
+        int attacker_type = piece_on[_count_trailing_zeros(move.src)] % 6;
+        int balance = victim == NO_PIECE ? 0 : see_piece_values[victim % 6];
+
+        if (attacker_type == PAWN && move.dst == en_passant)
+            balance = see_piece_values[PAWN];
+        balance -= threshold;
+
+        if (balance < 0)
+            return false;
+        if (balance - see_piece_values[attacker_type] >= 0)
+            return true;
+    }
+
+    return see(move) >= threshold;
+}
+
+string Board::get_name()
+{
+    return "BitBoard";
+}
+
+string Board::create_fen(bool with_turns)
+{
+    char fen[85];
+    int  fen_i = 0;
+
+    bzero(fen, 85);
+
+    int empty_cells_count = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            char piece = index_to_piece(piece_on[y * 8 + x]);
+            if (piece == EMPTY_CELL)
+            {
+                empty_cells_count++;
+                continue;
+            }
+
+            if (empty_cells_count > 0)
+            {
+                fen[fen_i++] = '0' + empty_cells_count;
+                empty_cells_count = 0;
+            }
+
+            fen[fen_i++] = piece;
+        }
+
+        if (empty_cells_count > 0)
+        {
+            fen[fen_i++] = '0' + empty_cells_count;
+            empty_cells_count = 0;
+        }
+
+        if (y != 7)
+            fen[fen_i++] = '/';
+    }
+    fen[fen_i++] = ' ';
+
+    fen[fen_i++] = white_turn ? 'w' : 'b';
+    fen[fen_i++] = ' ';
+
+    if (castles[WHITE] || castles[BLACK])
+    {
+        if (this->chess960_rule)
+            _create_fen_for_chess960_castling(fen, &fen_i);
+        else
+            _create_fen_for_standard_castling(fen, &fen_i);
+    }
+    else
+        fen[fen_i++] = '-';
+    fen[fen_i++] = ' ';
+
+    if (en_passant)
+    {
+        string en_passant_str = bitboard_to_algebraic(en_passant);
+        fen[fen_i++] = en_passant_str[0];
+        fen[fen_i++] = en_passant_str[1];
+    }
+    else
+        fen[fen_i++] = '-';
+    fen[fen_i++] = ' ';
+
+    string fen_string = string(fen, fen_i);
+
+    if (!with_turns)
+        return fen_string;
+
+    fen_string += to_string(half_turn_rule);
+    fen_string += string(" ");
+
+    fen_string += to_string(game_turn);
+
+    return fen_string;
+}
+
+void Board::pack(PackedBoard *packed)
+{
+    memset(packed, 0, sizeof(PackedBoard));
+
+    // Pieces masks are only updated at turn start, the bitboards always are
+    uint64_t occupancy = 0UL;
+    for (int color = WHITE; color <= BLACK; color++)
+        for (int type = PAWN; type <= KING; type++)
+            occupancy |= bitboards[color][type];
+
+    packed->occupancy = occupancy;
+    for (int i = 0; occupancy; i++)
+    {
+        packed->pieces[i / 2] |= piece_on[_count_trailing_zeros(occupancy)] << (i % 2 * 4);
+        occupancy &= occupancy - 1;
+    }
+
+    packed->castling_files[WHITE] = castles[WHITE] >> 56;
+    packed->castling_files[BLACK] = castles[BLACK];
+    packed->white_turn = white_turn;
+    packed->en_passant_file = en_passant ? _count_trailing_zeros(en_passant) % 8 : 8;
+    packed->half_turn_rule = half_turn_rule;
+    packed->game_turn = game_turn;
+}
+
+Board *Board::clone()
+{
+    Board *cloned_board = new Board();
+
+    *cloned_board = *this;
+
+    return cloned_board;
+}
+
+void Board::_main_parsing(
+    string _board,
+    string _color,
+    string _castling,
+    string _en_passant,
+    int    _half_turn_rule,
     int    _game_turn,
     bool   _chess960_rule,
     bool   _codingame_rule
@@ -1307,9 +2402,6 @@ void Board::_main_parsing(
     this->visual_board = VisualBoard();
 #endif
 
-    if (Board::lookup_tables_initialized == false)
-        Board::_initialize_lookup_tables();
-
     chess960_rule = _chess960_rule;
     codingame_rule = _codingame_rule;
 
@@ -1323,37 +2415,38 @@ void Board::_main_parsing(
     half_turn_rule = _half_turn_rule;
     game_turn = _game_turn;
 
+    _initialize_engine_data();
+}
+
+void Board::_initialize_engine_data()
+{
     moves_computed = false;
     game_state_computed = false;
     engine_data_updated = false;
 
-    fen_history_index = 0;
-    for (int i = 0; i < FEN_HISTORY_SIZE; i++)
-        fen_history[i] = string();
-    _update_fen_history();
+    position_history_index = 0;
+    memset(position_history, 0, sizeof(position_history));
+    _update_position_history();
 }
 
 void Board::_initialize_bitboards()
 {
-    white_pawns = 0UL;
-    white_knights = 0UL;
-    white_bishops = 0UL;
-    white_rooks = 0UL;
-    white_queens = 0UL;
-    white_king = 0UL;
-    black_pawns = 0UL;
-    black_knights = 0UL;
-    black_bishops = 0UL;
-    black_rooks = 0UL;
-    black_queens = 0UL;
-    black_king = 0UL;
-
-    white_castles = 0UL;
-    black_castles = 0UL;
+    memset(bitboards, 0, sizeof(bitboards));
+    memset(piece_on, NO_PIECE, sizeof(piece_on));
+
+    castles[WHITE] = 0UL;
+    castles[BLACK] = 0UL;
     en_passant = 0UL;
 
-    white_pieces_mask = 0UL;
-    black_pieces_mask = 0UL;
+    pieces_hash = 0UL;
+    pawns_hash = 0UL;
+#if USE_NNUE == 1
+    Nnue::initialize_accumulator(nnue_accumulators[WHITE]);
+    Nnue::initialize_accumulator(nnue_accumulators[BLACK]);
+#endif
+
+    pieces_masks[WHITE] = 0UL;
+    pieces_masks[BLACK] = 0UL;
     not_white_pieces_mask = 0UL;
     not_black_pieces_mask = 0UL;
     all_pieces_mask = 0UL;
@@ -1374,18 +2467,11 @@ void Board::_parse_board(string fen_board)
         }
         else if (piece != '/')
         {
-            white_pawns |= (uint64_t)(piece == 'P') << pos_index;
-            white_knights |= (uint64_t)(piece == 'N') << pos_index;
-            white_bishops |= (uint64_t)(piece == 'B') << pos_index;
-            white_rooks |= (uint64_t)(piece == 'R') << pos_index;
-            white_queens |= (uint64_t)(piece == 'Q') << pos_index;
-            white_king |= (uint64_t)(piece == 'K') << pos_index;
-            black_pawns |= (uint64_t)(piece == 'p') << pos_index;
-            black_knights |= (uint64_t)(piece == 'n') << pos_index;
-            black_bishops |= (uint64_t)(piece == 'b') << pos_index;
-            black_rooks |= (uint64_t)(piece == 'r') << pos_index;
-            black_queens |= (uint64_t)(piece == 'q') << pos_index;
-            black_king |= (uint64_t)(piece == 'k') << pos_index;
+            int piece_index = piece_to_index(piece);
+
+            bitboards[piece_index / 6][piece_index % 6] |= 1UL << pos_index;
+            piece_on[(int)pos_index] = piece_index;
+            _add_piece_features(piece_index, pos_index);
 
             pos_index++;
         }
@@ -1393,18 +2479,18 @@ void Board::_parse_board(string fen_board)
 
 #if USE_VISUAL_BOARD == 1
     this->visual_board.resetBoard();
-    this->visual_board.updateBoard('P', white_pawns);
-    this->visual_board.updateBoard('N', white_knights);
-    this->visual_board.updateBoard('B', white_bishops);
-    this->visual_board.updateBoard('R', white_rooks);
-    this->visual_board.updateBoard('Q', white_queens);
-    this->visual_board.updateBoard('K', white_king);
-    this->visual_board.updateBoard('p', black_pawns);
-    this->visual_board.updateBoard('n', black_knights);
-    this->visual_board.updateBoard('b', black_bishops);
-    this->visual_board.updateBoard('r', black_rooks);
-    this->visual_board.updateBoard('q', black_queens);
-    this->visual_board.updateBoard('k', black_king);
+    this->visual_board.updateBoard('P', white_pawns());
+    this->visual_board.updateBoard('N', white_knights());
+    this->visual_board.updateBoard('B', white_bishops());
+    this->visual_board.updateBoard('R', white_rooks());
+    this->visual_board.updateBoard('Q', white_queens());
+    this->visual_board.updateBoard('K', white_king());
+    this->visual_board.updateBoard('p', black_pawns());
+    this->visual_board.updateBoard('n', black_knights());
+    this->visual_board.updateBoard('b', black_bishops());
+    this->visual_board.updateBoard('r', black_rooks());
+    this->visual_board.updateBoard('q', black_queens());
+    this->visual_board.updateBoard('k', black_king());
 #endif
 }
 
@@ -1418,49 +2504,24 @@ void Board::_parse_castling(string castling_fen)
         if (isupper(castling_fen[i]))
         {
             if (chess960_rule)
-                white_castles |= algebraic_to_bitboard(string(1, castling_fen[i]) + '1');
+                castles[WHITE] |= algebraic_to_bitboard(string(1, castling_fen[i]) + '1');
             else
-                white_castles |=
+                castles[WHITE] |=
                     castling_fen[i] == 'K' ? 0x8000000000000000UL : 0x0100000000000000UL;
         }
         else
         {
             if (chess960_rule)
-                black_castles |= algebraic_to_bitboard(string(1, castling_fen[i]) + '8');
+                castles[BLACK] |= algebraic_to_bitboard(string(1, castling_fen[i]) + '8');
             else
-                black_castles |= castling_fen[i] == 'k' ? 0b10000000UL : 0b00000001UL;
+                castles[BLACK] |= castling_fen[i] == 'k' ? 0b10000000UL : 0b00000001UL;
         }
     }
 }
 
 char Board::_get_cell(uint64_t mask)
 {
-    if (white_pawns & mask)
-        return 'P';
-    if (white_knights & mask)
-        return 'N';
-    if (white_bishops & mask)
-        return 'B';
-    if (white_rooks & mask)
-        return 'R';
-    if (white_queens & mask)
-        return 'Q';
-    if (white_king & mask)
-        return 'K';
-    if (black_pawns & mask)
-        return 'p';
-    if (black_knights & mask)
-        return 'n';
-    if (black_bishops & mask)
-        return 'b';
-    if (black_rooks & mask)
-        return 'r';
-    if (black_queens & mask)
-        return 'q';
-    if (black_king & mask)
-        return 'k';
-
-    return EMPTY_CELL;
+    return index_to_piece(piece_on[_count_trailing_zeros(mask)]);
 }
 
 void Board::_create_fen_for_standard_castling(char *fen, int *fen_i)
@@ -1468,7 +2529,7 @@ void Board::_create_fen_for_standard_castling(char *fen, int *fen_i)
     uint64_t white_mask = 1UL << 63;
     for (int x = 7; x >= 0; x--)
     {
-        if (white_castles & white_mask)
+        if (castles[WHITE] & white_mask)
         {
             fen[*fen_i] = x == 0 ? 'Q' : 'K';
             (*fen_i)++;
@@ -1479,7 +2540,7 @@ void Board::_create_fen_for_standard_castling(char *fen, int *fen_i)
     uint64_t black_mask = 1UL << 7;
     for (int x = 7; x >= 0; x--)
     {
-        if (black_castles & black_mask)
+        if (castles[BLACK] & black_mask)
         {
             fen[*fen_i] = x == 0 ? 'q' : 'k';
             (*fen_i)++;
@@ -1493,7 +2554,7 @@ void Board::_create_fen_for_chess960_castling(char *fen, int *fen_i)
     uint64_t white_mask = 1UL << 56;
     for (int x = 0; x < 8; x++)
     {
-        if (white_castles & white_mask)
+        if (castles[WHITE] & white_mask)
         {
             fen[*fen_i] = toupper(column_index_to_name(x));
             (*fen_i)++;
@@ -1504,7 +2565,7 @@ void Board::_create_fen_for_chess960_castling(char *fen, int *fen_i)
     uint64_t black_mask = 1UL;
     for (int x = 0; x < 8; x++)
     {
-        if (black_castles & black_mask)
+        if (castles[BLACK] & black_mask)
         {
             fen[*fen_i] = column_index_to_name(x);
             (*fen_i)++;
@@ -1513,237 +2574,187 @@ void Board::_create_fen_for_chess960_castling(char *fen, int *fen_i)
     }
 }
 
-void Board::_apply_regular_white_move(uint64_t src, uint64_t dst, uint64_t *piece_mask)
+void Board::_apply_regular_move(int color, int type, int src_lkt_i, int dst_lkt_i)
 {
-    _capture_black_pieces(dst);
+    _capture_piece(dst_lkt_i);
 
-    *piece_mask &= ~src;
-    *piece_mask |= dst;
-}
+    bitboards[color][type] ^= (1UL << src_lkt_i) | (1UL << dst_lkt_i);
 
-void Board::_apply_regular_black_move(uint64_t src, uint64_t dst, uint64_t *piece_mask)
-{
-    _capture_white_pieces(dst);
+    piece_on[dst_lkt_i] = piece_on[src_lkt_i];
+    piece_on[src_lkt_i] = NO_PIECE;
 
-    *piece_mask &= ~src;
-    *piece_mask |= dst;
+    _remove_piece_features(color * 6 + type, src_lkt_i);
+    _add_piece_features(color * 6 + type, dst_lkt_i);
 }
 
-void Board::_move_white_pawn(uint64_t src, uint64_t dst, char promotion)
+void Board::_move_pawn(int color, int src_lkt_i, int dst_lkt_i, char promotion)
 {
     half_turn_rule = -1;
 
-    if (dst == en_passant)
-        black_pawns &= (~en_passant) << 8;
-
-    if ((src & 0x00FF000000000000UL) && (dst & 0x000000FF00000000UL))
-        next_turn_en_passant = src >> 8;
-
-    _capture_black_pieces(dst);
+    uint64_t dst = 1UL << dst_lkt_i;
 
-    white_pawns &= ~src;
+    // The pawn taken en passant stands on the source rank, in the destination file
+    if (dst == en_passant)
+    {
+        int captured_lkt_i = (src_lkt_i & 56) | (dst_lkt_i & 7);
 
-    char final_piece = promotion ? toupper(promotion) : 'P';
-    if (final_piece == 'P')
-        white_pawns |= dst;
-    else if (final_piece == 'N')
-        white_knights |= dst;
-    else if (final_piece == 'B')
-        white_bishops |= dst;
-    else if (final_piece == 'R')
-        white_rooks |= dst;
-    else if (final_piece == 'Q')
-        white_queens |= dst;
-}
+        bitboards[!color][PAWN] &= ~(1UL << captured_lkt_i);
+        piece_on[captured_lkt_i] = NO_PIECE;
+        _remove_piece_features(!color * 6 + PAWN, captured_lkt_i);
+    }
 
-void Board::_move_black_pawn(uint64_t src, uint64_t dst, char promotion)
-{
-    half_turn_rule = -1;
+    if (abs(dst_lkt_i - src_lkt_i) == 16)
+        next_turn_en_passant = 1UL << ((src_lkt_i + dst_lkt_i) / 2);
 
-    if (dst == en_passant)
-        white_pawns &= (~en_passant) >> 8;
+    _capture_piece(dst_lkt_i);
 
-    if ((src & 0x000000000000FF00UL) && (dst & 0x00000000FF000000UL))
-        next_turn_en_passant = src << 8;
+    int final_type = promotion ? piece_to_index(tolower(promotion)) % 6 : PAWN;
 
-    _capture_white_pieces(dst);
+    bitboards[color][PAWN] &= ~(1UL << src_lkt_i);
+    bitboards[color][final_type] |= dst;
 
-    black_pawns &= ~src;
+    piece_on[src_lkt_i] = NO_PIECE;
+    piece_on[dst_lkt_i] = color * 6 + final_type;
 
-    char final_piece = promotion ? promotion : 'p';
-    if (final_piece == 'p')
-        black_pawns |= dst;
-    else if (final_piece == 'n')
-        black_knights |= dst;
-    else if (final_piece == 'b')
-        black_bishops |= dst;
-    else if (final_piece == 'r')
-        black_rooks |= dst;
-    else if (final_piece == 'q')
-        black_queens |= dst;
+    _remove_piece_features(color * 6 + PAWN, src_lkt_i);
+    _add_piece_features(color * 6 + final_type, dst_lkt_i);
 }
 
-void Board::_move_white_king(uint64_t src, uint64_t dst, castle_info_e castle_info)
+void Board::_move_king(int color, int src_lkt_i, int dst_lkt_i, castle_info_e castle_info)
 {
+    uint64_t src = 1UL << src_lkt_i;
+    uint64_t dst = 1UL << dst_lkt_i;
+
     if (castle_info == NOINFO)
     {
-        if ((src & white_king) && (dst & white_rooks))
+        if ((src & bitboards[color][KING]) && (dst & bitboards[color][ROOK]))
         {
-            castle_info = dst < src ? WHITELEFT : WHITERIGHT;
+            if (color == WHITE)
+                castle_info = dst < src ? WHITELEFT : WHITERIGHT;
+            else
+                castle_info = dst < src ? BLACKLEFT : BLACKRIGHT;
         }
         else
             castle_info = NOTCASTLE;
     }
 
+    piece_on[src_lkt_i] = NO_PIECE;
+    _remove_piece_features(color * 6 + KING, src_lkt_i);
+
     if (castle_info == NOTCASTLE)
     {
-        _capture_black_pieces(dst);
+        _capture_piece(dst_lkt_i);
 
-        white_king = dst;
-    }
-    else if (castle_info == WHITELEFT)
-    {
-        white_rooks &= ~dst;
-        white_king = BITMASK_CASTLE_WHITE_LEFT_KING;
-        white_rooks |= BITMASK_CASTLE_WHITE_LEFT_ROOK;
+        bitboards[color][KING] = dst;
     }
-    else if (castle_info == WHITERIGHT)
-    {
-        white_rooks &= ~dst;
-        white_king = BITMASK_CASTLE_WHITE_RIGHT_KING;
-        white_rooks |= BITMASK_CASTLE_WHITE_RIGHT_ROOK;
-    }
-
-    white_castles = 0UL;
-}
-
-void Board::_move_black_king(uint64_t src, uint64_t dst, castle_info_e castle_info)
-{
-    if (castle_info == NOINFO)
+    else
     {
-        if ((src & black_king) && (dst & black_rooks))
+        bool     left = castle_info == WHITELEFT || castle_info == BLACKLEFT;
+        uint64_t king_dst;
+        uint64_t rook_dst;
+        if (color == WHITE)
         {
-            castle_info = dst < src ? BLACKLEFT : BLACKRIGHT;
+            king_dst = left ? BITMASK_CASTLE_WHITE_LEFT_KING : BITMASK_CASTLE_WHITE_RIGHT_KING;
+            rook_dst = left ? BITMASK_CASTLE_WHITE_LEFT_ROOK : BITMASK_CASTLE_WHITE_RIGHT_ROOK;
         }
         else
-            castle_info = NOTCASTLE;
-    }
+        {
+            king_dst = left ? BITMASK_CASTLE_BLACK_LEFT_KING : BITMASK_CASTLE_BLACK_RIGHT_KING;
+            rook_dst = left ? BITMASK_CASTLE_BLACK_LEFT_ROOK : BITMASK_CASTLE_BLACK_RIGHT_ROOK;
+        }
 
-    if (castle_info == NOTCASTLE)
-    {
-        _capture_white_pieces(dst);
+        bitboards[color][ROOK] &= ~dst;
+        bitboards[color][KING] = king_dst;
+        bitboards[color][ROOK] |= rook_dst;
 
-        black_king = dst;
-    }
-    else if (castle_info == BLACKLEFT)
-    {
-        black_rooks &= ~dst;
-        black_king = BITMASK_CASTLE_BLACK_LEFT_KING;
-        black_rooks |= BITMASK_CASTLE_BLACK_LEFT_ROOK;
-    }
-    else if (castle_info == BLACKRIGHT)
-    {
-        black_rooks &= ~dst;
-        black_king = BITMASK_CASTLE_BLACK_RIGHT_KING;
-        black_rooks |= BITMASK_CASTLE_BLACK_RIGHT_ROOK;
+        piece_on[dst_lkt_i] = NO_PIECE;
+        piece_on[_count_trailing_zeros(rook_dst)] = color * 6 + ROOK;
+
+        _remove_piece_features(color * 6 + ROOK, dst_lkt_i);
+        _add_piece_features(color * 6 + ROOK, _count_trailing_zeros(rook_dst));
     }
+    piece_on[_count_trailing_zeros(bitboards[color][KING])] = color * 6 + KING;
+    _add_piece_features(color * 6 + KING, _count_trailing_zeros(bitboards[color][KING]));
 
-    black_castles = 0UL;
+    castles[color] = 0UL;
 }
 
-void Board::_capture_white_pieces(uint64_t dst)
+void Board::_capture_piece(int dst_lkt_i)
 {
-    if (all_pieces_mask & dst)
+    int captured_piece = piece_on[dst_lkt_i];
+
+    if (captured_piece != NO_PIECE)
     {
         half_turn_rule = -1;
 
-        uint64_t not_dst_mask = ~dst;
+        uint64_t not_dst_mask = ~(1UL << dst_lkt_i);
+        int      color = captured_piece / 6;
 
-        if (dst & white_castles)
-        {
-            white_castles &= not_dst_mask;
-            white_rooks &= not_dst_mask;
-            return;
-        }
+        castles[color] &= not_dst_mask;
+        bitboards[color][captured_piece % 6] &= not_dst_mask;
 
-        white_pawns &= not_dst_mask;
-        white_knights &= not_dst_mask;
-        white_bishops &= not_dst_mask;
-        white_rooks &= not_dst_mask;
-        white_queens &= not_dst_mask;
+        _remove_piece_features(captured_piece, dst_lkt_i);
     }
 }
 
-void Board::_capture_black_pieces(uint64_t dst)
+void Board::_add_piece_features(int piece, int lkt_i)
 {
-    if (all_pieces_mask & dst)
-    {
-        half_turn_rule = -1;
+    pieces_hash ^= zobrist_lookup[piece][lkt_i];
+    if (piece % 6 == PAWN)
+        pawns_hash ^= zobrist_lookup[piece][lkt_i];
 
-        uint64_t not_dst_mask = ~dst;
+#if USE_NNUE == 1
+    Nnue::add_feature(nnue_accumulators[WHITE], Nnue::feature_index(WHITE, piece, lkt_i));
+    Nnue::add_feature(nnue_accumulators[BLACK], Nnue::feature_index(BLACK, piece, lkt_i));
+#endif
+}
 
-        if (dst & black_castles)
-        {
-            black_castles &= not_dst_mask;
-            black_rooks &= not_dst_mask;
-            return;
-        }
+void Board::_remove_piece_features(int piece, int lkt_i)
+{
+    pieces_hash ^= zobrist_lookup[piece][lkt_i];
+    if (piece % 6 == PAWN)
+        pawns_hash ^= zobrist_lookup[piece][lkt_i];
 
-        black_pawns &= not_dst_mask;
-        black_knights &= not_dst_mask;
-        black_bishops &= not_dst_mask;
-        black_rooks &= not_dst_mask;
-        black_queens &= not_dst_mask;
-    }
+#if USE_NNUE == 1
+    Nnue::remove_feature(nnue_accumulators[WHITE], Nnue::feature_index(WHITE, piece, lkt_i));
+    Nnue::remove_feature(nnue_accumulators[BLACK], Nnue::feature_index(BLACK, piece, lkt_i));
+#endif
 }
 
 void Board::_update_engine_at_turn_start()
 {
-    white_pieces_mask =
-        white_pawns | white_knights | white_bishops | white_rooks | white_queens | white_king;
-    black_pieces_mask =
-        black_pawns | black_knights | black_bishops | black_rooks | black_queens | black_king;
-    not_white_pieces_mask = ~white_pieces_mask;
-    not_black_pieces_mask = ~black_pieces_mask;
+    for (int color = WHITE; color <= BLACK; color++)
+    {
+        const uint64_t *pieces = bitboards[color];
+        pieces_masks[color] = pieces[PAWN] | pieces[KNIGHT] | pieces[BISHOP] | pieces[ROOK] |
+                              pieces[QUEEN] | pieces[KING];
+    }
+    not_white_pieces_mask = ~white_pieces_mask();
+    not_black_pieces_mask = ~black_pieces_mask();
 
-    all_pieces_mask = white_pieces_mask | black_pieces_mask;
+    all_pieces_mask = white_pieces_mask() | black_pieces_mask();
     empty_cells_mask = ~all_pieces_mask;
 
-    if (white_turn)
-    {
-        ally_king = white_king;
-        ally_pieces = white_pieces_mask;
-
-        enemy_pawns = black_pawns;
-        enemy_knights = black_knights;
-        enemy_bishops = black_bishops;
-        enemy_rooks = black_rooks;
-        enemy_queens = black_queens;
-    }
-    else
-    {
-        ally_king = black_king;
-        ally_pieces = black_pieces_mask;
+    int ally = white_turn ? WHITE : BLACK;
+    ally_king = bitboards[ally][KING];
+    ally_pieces = pieces_masks[ally];
 
-        enemy_pawns = white_pawns;
-        enemy_knights = white_knights;
-        enemy_bishops = white_bishops;
-        enemy_rooks = white_rooks;
-        enemy_queens = white_queens;
-    }
+    enemy_pawns = bitboards[!ally][PAWN];
+    enemy_knights = bitboards[!ally][KNIGHT];
+    enemy_bishops = bitboards[!ally][BISHOP];
+    enemy_rooks = bitboards[!ally][ROOK];
+    enemy_queens = bitboards[!ally][QUEEN];
     enemy_pieces_sliding_diag = enemy_bishops | enemy_queens;
     enemy_pieces_sliding_line = enemy_rooks | enemy_queens;
 
-    capturable_by_white_pawns_mask = black_pieces_mask | en_passant;
-    capturable_by_black_pawns_mask = white_pieces_mask | en_passant;
+    capturable_by_white_pawns_mask = black_pieces_mask() | en_passant;
+    capturable_by_black_pawns_mask = white_pieces_mask() | en_passant;
 
     check_state = false;
     double_check = false;
     uncheck_mask = 0UL;
     pawn_uncheck_mask = 0UL;
-    std::fill(std::begin(pin_masks), std::end(pin_masks), BITMASK_ALL_CELLS);
-    attacked_by_white_mask = 0UL;
-    attacked_by_black_mask = 0UL;
+    pinned_mask = 0UL;
 
     _update_check_and_pins();
     _update_attacked_cells_masks();
@@ -1753,6 +2764,20 @@ void Board::_update_engine_at_turn_start()
     engine_data_updated = true;
 }
 
+uint64_t Board::attackers_to(int square, uint64_t occupancy)
+{
+    uint64_t diagonal_sliders = white_bishops() | white_queens() | black_bishops() | black_queens();
+    uint64_t line_sliders = white_rooks() | white_queens() | black_rooks() | black_queens();
+
+    // A white pawn attacks the square if a black pawn on the square would attack it, and vice versa
+    return (pawn_captures_lookup[square][BLACK] & white_pawns()) |
+           (pawn_captures_lookup[square][WHITE] & black_pawns()) |
+           (knight_lookup[square] & (white_knights() | black_knights())) |
+           (king_lookup[square] & (white_king() | black_king())) |
+           (_get_diagonal_attacks(square, occupancy) & diagonal_sliders) |
+           (_get_line_attacks(square, occupancy) & line_sliders);
+}
+
 void Board::_update_check_and_pins()
 {
     if (ally_king == 0UL)
@@ -1762,117 +2787,85 @@ void Board::_update_check_and_pins()
         return;
     }
 
-    int king_lkt_i = _count_trailing_zeros(ally_king);
+    int      king_lkt_i = _count_trailing_zeros(ally_king);
+    uint64_t enemy_pieces_mask = all_pieces_mask & ~ally_pieces;
 
-    _update_pawn_check(king_lkt_i);
-
-    uint64_t knight_attacks = knight_lookup[king_lkt_i] & enemy_knights;
-    if (knight_attacks)
+    uint64_t checkers = attackers_to(king_lkt_i, all_pieces_mask) & enemy_pieces_mask;
+    if (checkers)
     {
         check_state = true;
-        uncheck_mask |= knight_attacks;
-    }
+        double_check = (checkers & (checkers - 1)) != 0UL;
 
-    _compute_sliding_piece_negative_ray_checks_and_pins(
-        ally_king, NORTHEAST, enemy_pieces_sliding_diag
-    );
-    _compute_sliding_piece_positive_ray_checks_and_pins(
-        ally_king, SOUTHEAST, enemy_pieces_sliding_diag
-    );
-    _compute_sliding_piece_positive_ray_checks_and_pins(
-        ally_king, SOUTHWEST, enemy_pieces_sliding_diag
-    );
-    _compute_sliding_piece_negative_ray_checks_and_pins(
-        ally_king, NORTHWEST, enemy_pieces_sliding_diag
-    );
+        // Only king moves are generated in double check, so the uncheck mask is left empty
+        if (!double_check)
+        {
+            uncheck_mask = checkers | between_lookup[king_lkt_i][_count_trailing_zeros(checkers)];
 
-    _compute_sliding_piece_negative_ray_checks_and_pins(
-        ally_king, NORTH, enemy_pieces_sliding_line
-    );
-    _compute_sliding_piece_positive_ray_checks_and_pins(ally_king, EAST, enemy_pieces_sliding_line);
-    _compute_sliding_piece_positive_ray_checks_and_pins(
-        ally_king, SOUTH, enemy_pieces_sliding_line
-    );
-    _compute_sliding_piece_negative_ray_checks_and_pins(ally_king, WEST, enemy_pieces_sliding_line);
+            // The pawn which just moved 2 cells can also be removed by capturing it en passant
+            if (checkers == (white_turn ? en_passant << 8 : en_passant >> 8))
+                pawn_uncheck_mask = en_passant;
+        }
+    }
 
-    if (uncheck_mask == 0UL)
+    // Enemy sliders seeing the king through exactly one ally piece pin it on their ray
+    uint64_t snipers = (_get_diagonal_attacks(king_lkt_i, 0UL) & enemy_pieces_sliding_diag) |
+                       (_get_line_attacks(king_lkt_i, 0UL) & enemy_pieces_sliding_line);
+    while (snipers)
     {
-        check_state = false;
-        uncheck_mask = BITMASK_ALL_CELLS;
+        int      sniper_lkt_i = _count_trailing_zeros(snipers);
+        uint64_t blockers = between_lookup[king_lkt_i][sniper_lkt_i] & all_pieces_mask;
+
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & ally_pieces))
+        {
+            pinned_mask |= blockers;
+            pin_masks[_count_trailing_zeros(blockers)] =
+                between_lookup[king_lkt_i][sniper_lkt_i] | (1UL << sniper_lkt_i);
+        }
+
+        snipers &= snipers - 1;
     }
+
+    if (en_passant)
+        _update_en_passant_pins(king_lkt_i);
+
+    if (!check_state)
+        uncheck_mask = BITMASK_ALL_CELLS;
 }
 
-void Board::_update_pawn_check(int king_lkt_i)
+void Board::_update_en_passant_pins(int king_lkt_i)
 {
-    int lkt_color = white_turn ? 0 : 1;
+    int      ally = white_turn ? WHITE : BLACK;
+    int      en_passant_lkt_i = _count_trailing_zeros(en_passant);
+    uint64_t captured_pawn = white_turn ? en_passant << 8 : en_passant >> 8;
+    uint64_t capturing_pawns =
+        pawn_captures_lookup[en_passant_lkt_i][!ally] & bitboards[ally][PAWN];
 
-    uint64_t attacking_pawn = pawn_captures_lookup[king_lkt_i][lkt_color] & enemy_pawns;
-    if (attacking_pawn)
+    // Both pawns leave the rank at once, which can uncover a slider that no pin mask covers
+    while (capturing_pawns)
     {
-        check_state = true;
-        uncheck_mask |= attacking_pawn;
+        uint64_t pawn = _get_least_significant_bit(capturing_pawns);
+        uint64_t occupancy = (all_pieces_mask ^ pawn ^ captured_pawn) | en_passant;
 
-        if (en_passant)
+        if ((_get_diagonal_attacks(king_lkt_i, occupancy) & enemy_pieces_sliding_diag) |
+            (_get_line_attacks(king_lkt_i, occupancy) & enemy_pieces_sliding_line))
         {
-            if (white_turn)
-            {
-                if (attacking_pawn == (en_passant << 8))
-                {
-                    if (!_is_sliding_piece_negative_diagonal_ray_behind(
-                            attacking_pawn, ally_king == attacking_pawn - 9 ? NORTHWEST : NORTHEAST
-                        ))
-                        pawn_uncheck_mask = en_passant;
-                }
-            }
-            else
-            {
-                if (attacking_pawn == (en_passant >> 8))
-                {
-                    if (!_is_sliding_piece_positive_diagonal_ray_behind(
-                            attacking_pawn, ally_king == attacking_pawn + 7 ? SOUTHWEST : SOUTHEAST
-                        ))
-                        pawn_uncheck_mask = en_passant;
-                }
-            }
+            int pawn_lkt_i = _count_trailing_zeros(pawn);
+
+            pin_masks[pawn_lkt_i] = _get_pin_mask(pawn_lkt_i) & ~en_passant;
+            pinned_mask |= pawn;
         }
+
+        capturing_pawns ^= pawn;
     }
 }
 
 void Board::_update_attacked_cells_masks()
 {
-    _apply_function_on_all_pieces(
-        black_pawns, [this](uint64_t param) { _find_black_pawns_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        black_knights, [this](uint64_t param) { _find_black_knights_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        black_bishops, [this](uint64_t param) { _find_black_bishops_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        black_rooks, [this](uint64_t param) { _find_black_rooks_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        black_queens, [this](uint64_t param) { _find_black_queens_attacks(param); }
-    );
-    _find_black_king_attacks();
+    int enemy = white_turn ? BLACK : WHITE;
 
-    _apply_function_on_all_pieces(
-        white_pawns, [this](uint64_t param) { _find_white_pawns_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        white_knights, [this](uint64_t param) { _find_white_knights_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        white_bishops, [this](uint64_t param) { _find_white_bishops_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        white_rooks, [this](uint64_t param) { _find_white_rooks_attacks(param); }
-    );
-    _apply_function_on_all_pieces(
-        white_queens, [this](uint64_t param) { _find_white_queens_attacks(param); }
-    );
-    _find_white_king_attacks();
+    attacked_by_masks[enemy] = _find_attacks(enemy);
+    attacked_by_masks[!enemy] = 0UL;
+    ally_attacked_cells_computed = false;
 }
 
 void Board::_update_engine_at_turn_end()
@@ -1881,8 +2874,12 @@ void Board::_update_engine_at_turn_end()
     if (PRINT_DEBUG_DATA)
     {
         this->log(true);
-        this->visual_board.printSpecificBoard('W', attacked_by_white_mask, "Attacked by white");
-        this->visual_board.printSpecificBoard('B', attacked_by_black_mask, "Attacked by black");
+        this->visual_board.printSpecificBoard(
+            'W', get_attacked_cells_mask(WHITE), "Attacked by white"
+        );
+        this->visual_board.printSpecificBoard(
+            'B', get_attacked_cells_mask(BLACK), "Attacked by black"
+        );
     }
 #endif
 
@@ -1899,89 +2896,72 @@ void Board::_update_engine_at_turn_end()
         game_turn += 1;
     white_turn = !white_turn;
 
-    _update_fen_history();
+    _update_position_history();
 }
 
-void Board::_update_fen_history()
+void Board::_update_position_history()
 {
-    string fen = create_fen(false);
+    if (position_history_index == POSITION_HISTORY_SIZE)
+        position_history_index = 0;
 
-    if (fen_history_index == FEN_HISTORY_SIZE)
-        fen_history_index = 0;
-
-    fen_history[fen_history_index++] = fen;
+    position_history[position_history_index++] = get_hash();
 }
 
-void Board::_find_white_pawns_attacks(uint64_t src)
+uint64_t Board::_find_attacks(int color)
 {
-    int src_lkt_i = _count_trailing_zeros(src);
-    attacked_by_white_mask |= pawn_captures_lookup[src_lkt_i][0];
-}
+    const uint64_t *pieces = bitboards[color];
+    uint64_t        attacks;
 
-void Board::_find_white_knights_attacks(uint64_t src)
-{
-    int src_lkt_i = _count_trailing_zeros(src);
-    attacked_by_white_mask |= knight_lookup[src_lkt_i];
-}
-
-void Board::_find_white_bishops_attacks(uint64_t src)
-{
-    attacked_by_white_mask |= _get_diagonal_rays(src, black_king);
-}
-
-void Board::_find_white_rooks_attacks(uint64_t src)
-{
-    attacked_by_white_mask |= _get_line_rays(src, black_king);
-}
-
-void Board::_find_white_queens_attacks(uint64_t src)
-{
-    attacked_by_white_mask |= _get_diagonal_rays(src, black_king) | _get_line_rays(src, black_king);
-}
-
-void Board::_find_white_king_attacks()
-{
-    if (white_king)
-    {
-        int src_lkt_i = _count_trailing_zeros(white_king);
-        attacked_by_white_mask |= king_lookup[src_lkt_i];
-    }
-}
-
-void Board::_find_black_pawns_attacks(uint64_t src)
-{
-    int src_lkt_i = _count_trailing_zeros(src);
-    attacked_by_black_mask |= pawn_captures_lookup[src_lkt_i][1];
-}
-
-void Board::_find_black_knights_attacks(uint64_t src)
-{
-    int src_lkt_i = _count_trailing_zeros(src);
-    attacked_by_black_mask |= knight_lookup[src_lkt_i];
-}
+    // White pawns move toward lower indexes, black ones toward higher indexes
+    if (color == WHITE)
+        attacks = ((pieces[PAWN] >> 7) & BITMASK_NOT_FILE_A) |
+                  ((pieces[PAWN] >> 9) & BITMASK_NOT_FILE_H);
+    else
+        attacks = ((pieces[PAWN] << 9) & BITMASK_NOT_FILE_A) |
+                  ((pieces[PAWN] << 7) & BITMASK_NOT_FILE_H);
+
+    uint64_t knights = pieces[KNIGHT];
+    attacks |= (((knights << 17) | (knights >> 15)) & BITMASK_NOT_FILE_A) |
+               (((knights << 15) | (knights >> 17)) & BITMASK_NOT_FILE_H) |
+               (((knights << 10) | (knights >> 6)) & BITMASK_NOT_FILE_AB) |
+               (((knights << 6) | (knights >> 10)) & BITMASK_NOT_FILE_GH);
+
+    if (pieces[KING])
+        attacks |= king_lookup[_count_trailing_zeros(pieces[KING])];
+
+    // Sliding attacks go through the enemy king, so it can't step back along the ray
+    uint64_t empty = empty_cells_mask | bitboards[!color][KING];
+    uint64_t diagonal_sliders = pieces[BISHOP] | pieces[QUEEN];
+    uint64_t line_sliders = pieces[ROOK] | pieces[QUEEN];
+
+    attacks |= _find_sliding_attacks(diagonal_sliders, empty, -7, BITMASK_NOT_FILE_A) |
+               _find_sliding_attacks(diagonal_sliders, empty, 9, BITMASK_NOT_FILE_A) |
+               _find_sliding_attacks(diagonal_sliders, empty, 7, BITMASK_NOT_FILE_H) |
+               _find_sliding_attacks(diagonal_sliders, empty, -9, BITMASK_NOT_FILE_H);
+    attacks |= _find_sliding_attacks(line_sliders, empty, -8, BITMASK_ALL_CELLS) |
+               _find_sliding_attacks(line_sliders, empty, 1, BITMASK_NOT_FILE_A) |
+               _find_sliding_attacks(line_sliders, empty, 8, BITMASK_ALL_CELLS) |
+               _find_sliding_attacks(line_sliders, empty, -1, BITMASK_NOT_FILE_H);
 
-void Board::_find_black_bishops_attacks(uint64_t src)
-{
-    attacked_by_black_mask |= _get_diagonal_rays(src, white_king);
+    return attacks;
 }
 
-void Board::_find_black_rooks_attacks(uint64_t src)
+uint64_t Board::_find_sliding_attacks(uint64_t sliders, uint64_t empty, int shift, uint64_t wrap)
 {
-    attacked_by_black_mask |= _get_line_rays(src, white_king);
-}
+    // Kogge-Stone occluded fill: the sliders are propagated through empty cells by 1, 2 then 4
+    // steps, wrap masks out the cells a step would reach by crossing the board edge
+    auto shift_by = [shift](uint64_t bitboard, int steps) {
+        return shift > 0 ? bitboard << (shift * steps) : bitboard >> (-shift * steps);
+    };
 
-void Board::_find_black_queens_attacks(uint64_t src)
-{
-    attacked_by_black_mask |= _get_diagonal_rays(src, white_king) | _get_line_rays(src, white_king);
-}
+    uint64_t propagator = empty & wrap;
+    sliders |= propagator & shift_by(sliders, 1);
+    propagator &= shift_by(propagator, 1);
+    sliders |= propagator & shift_by(sliders, 2);
+    propagator &= shift_by(propagator, 2);
+    sliders |= propagator & shift_by(sliders, 4);
 
-void Board::_find_black_king_attacks()
-{
-    if (black_king)
-    {
-        int src_lkt_i = _count_trailing_zeros(black_king);
-        attacked_by_black_mask |= king_lookup[src_lkt_i];
-    }
+    return shift_by(sliders, 1) & wrap;
 }
 
 void Board::_find_moves()
@@ -1993,22 +2973,23 @@ void Board::_find_moves()
         if (!double_check)
         {
             _apply_function_on_all_pieces(
-                white_pawns, [this](uint64_t param) { _find_white_pawns_moves(param); }
+                white_pawns(), [this](uint64_t param) { _find_white_pawns_moves(param); }
             );
             _apply_function_on_all_pieces(
-                white_queens, [this](uint64_t param) { _find_white_queens_moves(param); }
+                white_queens(), [this](uint64_t param) { _find_white_queens_moves(param); }
             );
             _apply_function_on_all_pieces(
-                white_rooks, [this](uint64_t param) { _find_white_rooks_moves(param); }
+                white_rooks(), [this](uint64_t param) { _find_white_rooks_moves(param); }
             );
             _apply_function_on_all_pieces(
-                white_bishops, [this](uint64_t param) { _find_white_bishops_moves(param); }
+                white_bishops(), [this](uint64_t param) { _find_white_bishops_moves(param); }
             );
             _apply_function_on_all_pieces(
-                white_knights, [this](uint64_t param) { _find_white_knights_moves(param); }
+                white_knights(), [this](uint64_t param) { _find_white_knights_moves(param); }
             );
             _apply_function_on_all_pieces(
-                white_castles, [this](uint64_t param) { _find_white_castle_moves(param); }
+                castles[WHITE],
+                [this](uint64_t param) { _find_white_castle_moves(param, &this->available_moves); }
             );
         }
         _find_white_king_moves();
@@ -2018,22 +2999,23 @@ void Board::_find_moves()
         if (!double_check)
         {
             _apply_function_on_all_pieces(
-                black_pawns, [this](uint64_t param) { _find_black_pawns_moves(param); }
+                black_pawns(), [this](uint64_t param) { _find_black_pawns_moves(param); }
             );
             _apply_function_on_all_pieces(
-                black_queens, [this](uint64_t param) { _find_black_queens_moves(param); }
+                black_queens(), [this](uint64_t param) { _find_black_queens_moves(param); }
             );
             _apply_function_on_all_pieces(
-                black_rooks, [this](uint64_t param) { _find_black_rooks_moves(param); }
+                black_rooks(), [this](uint64_t param) { _find_black_rooks_moves(param); }
             );
             _apply_function_on_all_pieces(
-                black_bishops, [this](uint64_t param) { _find_black_bishops_moves(param); }
+                black_bishops(), [this](uint64_t param) { _find_black_bishops_moves(param); }
             );
             _apply_function_on_all_pieces(
-                black_knights, [this](uint64_t param) { _find_black_knights_moves(param); }
+                black_knights(), [this](uint64_t param) { _find_black_knights_moves(param); }
             );
             _apply_function_on_all_pieces(
-                black_castles, [this](uint64_t param) { _find_black_castle_moves(param); }
+                castles[BLACK],
+                [this](uint64_t param) { _find_black_castle_moves(param, &this->available_moves); }
             );
         }
         _find_black_king_moves();
@@ -2042,6 +3024,40 @@ void Board::_find_moves()
     this->moves_computed = true;
 }
 
+bool Board::_has_legal_moves()
+{
+    if (this->moves_computed)
+        return !this->available_moves.empty();
+
+    // Most of the time the king can step somewhere, which spares the full generation
+    int ally = white_turn ? WHITE : BLACK;
+    if (ally_king && (king_lookup[_count_trailing_zeros(ally_king)] & ~ally_pieces &
+                      ~get_attacked_cells_mask(!ally)))
+        return true;
+
+    return !get_available_moves().empty();
+}
+
+void Board::_add_pseudo_legal_moves(vector<Move> *moves, char piece, uint64_t src, uint64_t dsts)
+{
+    while (dsts)
+    {
+        uint64_t dst = _get_least_significant_bit(dsts);
+
+        if (tolower(piece) == 'p' && (dst & BITMASK_LINE_81))
+        {
+            moves->push_back(Move(piece, src, dst, 'q'));
+            moves->push_back(Move(piece, src, dst, 'n'));
+            moves->push_back(Move(piece, src, dst, 'r'));
+            moves->push_back(Move(piece, src, dst, 'b'));
+        }
+        else
+            moves->push_back(Move(piece, src, dst));
+
+        dsts ^= dst;
+    }
+}
+
 void Board::_find_white_pawns_moves(uint64_t src)
 {
     int src_lkt_i = _count_trailing_zeros(src);
@@ -2049,10 +3065,11 @@ void Board::_find_white_pawns_moves(uint64_t src)
     uint64_t capture_moves = pawn_captures_lookup[src_lkt_i][0] & capturable_by_white_pawns_mask;
     uint64_t advance_move = (src >> 8) & empty_cells_mask;
     uint64_t legal_moves =
-        (capture_moves | advance_move) & pawn_uncheck_mask & pin_masks[src_lkt_i];
+        (capture_moves | advance_move) & pawn_uncheck_mask & _get_pin_mask(src_lkt_i);
 
     if (src & BITMASK_LINE_2 && (src >> 8) & empty_cells_mask)
-        legal_moves |= (src >> 16) & empty_cells_mask & pawn_uncheck_mask & pin_masks[src_lkt_i];
+        legal_moves |=
+            (src >> 16) & empty_cells_mask & pawn_uncheck_mask & _get_pin_mask(src_lkt_i);
 
     uint64_t dst;
     while (legal_moves)
@@ -2068,7 +3085,7 @@ void Board::_find_white_knights_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves =
-        knight_lookup[src_lkt_i] & not_white_pieces_mask & uncheck_mask & pin_masks[src_lkt_i];
+        knight_lookup[src_lkt_i] & not_white_pieces_mask & uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('N', src, legal_moves);
 }
@@ -2077,7 +3094,7 @@ void Board::_find_white_bishops_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves =
-        not_white_pieces_mask & _get_diagonal_rays(src) & uncheck_mask & pin_masks[src_lkt_i];
+        not_white_pieces_mask & _get_diagonal_rays(src) & uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('B', src, legal_moves);
 }
@@ -2086,7 +3103,7 @@ void Board::_find_white_rooks_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves =
-        not_white_pieces_mask & _get_line_rays(src) & uncheck_mask & pin_masks[src_lkt_i];
+        not_white_pieces_mask & _get_line_rays(src) & uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('R', src, legal_moves);
 }
@@ -2095,40 +3112,40 @@ void Board::_find_white_queens_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves = not_white_pieces_mask & (_get_diagonal_rays(src) | _get_line_rays(src)) &
-                           uncheck_mask & pin_masks[src_lkt_i];
+                           uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('Q', src, legal_moves);
 }
 
 void Board::_find_white_king_moves()
 {
-    if (white_king)
+    if (white_king())
     {
-        int      src_lkt_i = _count_trailing_zeros(white_king);
+        int      src_lkt_i = _count_trailing_zeros(white_king());
         uint64_t legal_moves =
-            king_lookup[src_lkt_i] & not_white_pieces_mask & ~attacked_by_black_mask;
+            king_lookup[src_lkt_i] & not_white_pieces_mask & ~get_attacked_cells_mask(BLACK);
 
-        _create_piece_moves('K', white_king, legal_moves);
+        _create_piece_moves('K', white_king(), legal_moves);
     }
 }
 
-void Board::_find_white_castle_moves(uint64_t rook)
+void Board::_find_white_castle_moves(uint64_t rook, vector<Move> *moves)
 {
-    if (white_king && !check_state)
+    if (white_king() && !check_state)
     {
         uint64_t      rook_path;
         uint64_t      king_path;
         castle_info_e castle_info;
-        if (rook < white_king)
+        if (rook < white_king())
         {
             castle_info = WHITELEFT;
 
-            if (white_king < BITMASK_CASTLE_WHITE_LEFT_KING)
+            if (white_king() < BITMASK_CASTLE_WHITE_LEFT_KING)
                 king_path =
-                    _compute_castling_positive_path(white_king, BITMASK_CASTLE_WHITE_LEFT_KING);
+                    _compute_castling_positive_path(white_king(), BITMASK_CASTLE_WHITE_LEFT_KING);
             else
                 king_path =
-                    _compute_castling_negative_path(white_king, BITMASK_CASTLE_WHITE_LEFT_KING);
+                    _compute_castling_negative_path(white_king(), BITMASK_CASTLE_WHITE_LEFT_KING);
             if (rook < BITMASK_CASTLE_WHITE_LEFT_ROOK)
                 rook_path = _compute_castling_positive_path(rook, BITMASK_CASTLE_WHITE_LEFT_ROOK);
             else
@@ -2138,23 +3155,23 @@ void Board::_find_white_castle_moves(uint64_t rook)
         {
             castle_info = WHITERIGHT;
 
-            if (white_king < BITMASK_CASTLE_WHITE_RIGHT_KING)
+            if (white_king() < BITMASK_CASTLE_WHITE_RIGHT_KING)
                 king_path =
-                    _compute_castling_positive_path(white_king, BITMASK_CASTLE_WHITE_RIGHT_KING);
+                    _compute_castling_positive_path(white_king(), BITMASK_CASTLE_WHITE_RIGHT_KING);
             else
                 king_path =
-                    _compute_castling_negative_path(white_king, BITMASK_CASTLE_WHITE_RIGHT_KING);
+                    _compute_castling_negative_path(white_king(), BITMASK_CASTLE_WHITE_RIGHT_KING);
             if (rook < BITMASK_CASTLE_WHITE_RIGHT_ROOK)
                 rook_path = _compute_castling_positive_path(rook, BITMASK_CASTLE_WHITE_RIGHT_ROOK);
             else
                 rook_path = _compute_castling_negative_path(rook, BITMASK_CASTLE_WHITE_RIGHT_ROOK);
         }
 
-        if (((king_path | rook_path) & (all_pieces_mask ^ white_king ^ rook)) == 0UL &&
-            (king_path & attacked_by_black_mask) == 0UL &&
-            pin_masks[_count_trailing_zeros(rook)] == BITMASK_ALL_CELLS)
+        if (((king_path | rook_path) & (all_pieces_mask ^ white_king() ^ rook)) == 0UL &&
+            (king_path & get_attacked_cells_mask(BLACK)) == 0UL &&
+            (pinned_mask & rook) == 0UL)
         {
-            this->available_moves.push_back(Move('K', white_king, rook, 0, castle_info));
+            moves->push_back(Move('K', white_king(), rook, 0, castle_info));
         }
     }
 }
@@ -2166,10 +3183,11 @@ void Board::_find_black_pawns_moves(uint64_t src)
     uint64_t capture_moves = pawn_captures_lookup[src_lkt_i][1] & capturable_by_black_pawns_mask;
     uint64_t advance_move = (src << 8) & empty_cells_mask;
     uint64_t legal_moves =
-        (capture_moves | advance_move) & pawn_uncheck_mask & pin_masks[src_lkt_i];
+        (capture_moves | advance_move) & pawn_uncheck_mask & _get_pin_mask(src_lkt_i);
 
     if (src & BITMASK_LINE_7 && (src << 8) & empty_cells_mask)
-        legal_moves |= (src << 16) & empty_cells_mask & pawn_uncheck_mask & pin_masks[src_lkt_i];
+        legal_moves |=
+            (src << 16) & empty_cells_mask & pawn_uncheck_mask & _get_pin_mask(src_lkt_i);
 
     uint64_t dst;
     while (legal_moves)
@@ -2185,7 +3203,7 @@ void Board::_find_black_knights_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves =
-        knight_lookup[src_lkt_i] & not_black_pieces_mask & uncheck_mask & pin_masks[src_lkt_i];
+        knight_lookup[src_lkt_i] & not_black_pieces_mask & uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('n', src, legal_moves);
 }
@@ -2194,7 +3212,7 @@ void Board::_find_black_bishops_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves =
-        not_black_pieces_mask & _get_diagonal_rays(src) & uncheck_mask & pin_masks[src_lkt_i];
+        not_black_pieces_mask & _get_diagonal_rays(src) & uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('b', src, legal_moves);
 }
@@ -2203,7 +3221,7 @@ void Board::_find_black_rooks_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves =
-        not_black_pieces_mask & _get_line_rays(src) & uncheck_mask & pin_masks[src_lkt_i];
+        not_black_pieces_mask & _get_line_rays(src) & uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('r', src, legal_moves);
 }
@@ -2212,40 +3230,40 @@ void Board::_find_black_queens_moves(uint64_t src)
 {
     int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t legal_moves = not_black_pieces_mask & (_get_diagonal_rays(src) | _get_line_rays(src)) &
-                           uncheck_mask & pin_masks[src_lkt_i];
+                           uncheck_mask & _get_pin_mask(src_lkt_i);
 
     _create_piece_moves('q', src, legal_moves);
 }
 
 void Board::_find_black_king_moves()
 {
-    if (black_king)
+    if (black_king())
     {
-        int      src_lkt_i = _count_trailing_zeros(black_king);
+        int      src_lkt_i = _count_trailing_zeros(black_king());
         uint64_t legal_moves =
-            king_lookup[src_lkt_i] & not_black_pieces_mask & ~attacked_by_white_mask;
+            king_lookup[src_lkt_i] & not_black_pieces_mask & ~get_attacked_cells_mask(WHITE);
 
-        _create_piece_moves('k', black_king, legal_moves);
+        _create_piece_moves('k', black_king(), legal_moves);
     }
 }
 
-void Board::_find_black_castle_moves(uint64_t rook)
+void Board::_find_black_castle_moves(uint64_t rook, vector<Move> *moves)
 {
-    if (black_king && !check_state)
+    if (black_king() && !check_state)
     {
         uint64_t      rook_path;
         uint64_t      king_path;
         castle_info_e castle_info;
-        if (rook < black_king)
+        if (rook < black_king())
         {
             castle_info = BLACKLEFT;
 
-            if (black_king < BITMASK_CASTLE_BLACK_LEFT_KING)
+            if (black_king() < BITMASK_CASTLE_BLACK_LEFT_KING)
                 king_path =
-                    _compute_castling_positive_path(black_king, BITMASK_CASTLE_BLACK_LEFT_KING);
+                    _compute_castling_positive_path(black_king(), BITMASK_CASTLE_BLACK_LEFT_KING);
             else
                 king_path =
-                    _compute_castling_negative_path(black_king, BITMASK_CASTLE_BLACK_LEFT_KING);
+                    _compute_castling_negative_path(black_king(), BITMASK_CASTLE_BLACK_LEFT_KING);
             if (rook < BITMASK_CASTLE_BLACK_LEFT_ROOK)
                 rook_path = _compute_castling_positive_path(rook, BITMASK_CASTLE_BLACK_LEFT_ROOK);
             else
@@ -2255,23 +3273,23 @@ void Board::_find_black_castle_moves(uint64_t rook)
         {
             castle_info = BLACKRIGHT;
 
-            if (black_king < BITMASK_CASTLE_BLACK_RIGHT_KING)
+            if (black_king() < BITMASK_CASTLE_BLACK_RIGHT_KING)
                 king_path =
-                    _compute_castling_positive_path(black_king, BITMASK_CASTLE_BLACK_RIGHT_KING);
+                    _compute_castling_positive_path(black_king(), BITMASK_CASTLE_BLACK_RIGHT_KING);
             else
                 king_path =
-                    _compute_castling_negative_path(black_king, BITMASK_CASTLE_BLACK_RIGHT_KING);
+                    _compute_castling_negative_path(black_king(), BITMASK_CASTLE_BLACK_RIGHT_KING);
             if (rook < BITMASK_CASTLE_BLACK_RIGHT_ROOK)
                 rook_path = _compute_castling_positive_path(rook, BITMASK_CASTLE_BLACK_RIGHT_ROOK);
             else
                 rook_path = _compute_castling_negative_path(rook, BITMASK_CASTLE_BLACK_RIGHT_ROOK);
         }
 
-        if (((king_path | rook_path) & (all_pieces_mask ^ black_king ^ rook)) == 0UL &&
-            (king_path & attacked_by_white_mask) == 0UL &&
-            (pin_masks[_count_trailing_zeros(rook)] == BITMASK_ALL_CELLS))
+        if (((king_path | rook_path) & (all_pieces_mask ^ black_king() ^ rook)) == 0UL &&
+            (king_path & get_attacked_cells_mask(WHITE)) == 0UL &&
+            (pinned_mask & rook) == 0UL)
         {
-            this->available_moves.push_back(Move('k', black_king, rook, 0, castle_info));
+            moves->push_back(Move('k', black_king(), rook, 0, castle_info));
         }
     }
 }
@@ -2320,171 +3338,52 @@ void Board::_apply_function_on_all_pieces(uint64_t bitboard, std::function<void(
 
 uint64_t Board::_get_diagonal_rays(uint64_t src, uint64_t piece_to_ignore)
 {
-    return _compute_sliding_piece_positive_ray(src, SOUTHEAST, piece_to_ignore) |
-           _compute_sliding_piece_positive_ray(src, SOUTHWEST, piece_to_ignore) |
-           _compute_sliding_piece_negative_ray(src, NORTHWEST, piece_to_ignore) |
-           _compute_sliding_piece_negative_ray(src, NORTHEAST, piece_to_ignore);
+    return _get_diagonal_attacks(_count_trailing_zeros(src), all_pieces_mask ^ piece_to_ignore);
 }
 
 uint64_t Board::_get_line_rays(uint64_t src, uint64_t piece_to_ignore)
 {
-    return _compute_sliding_piece_positive_ray(src, EAST, piece_to_ignore) |
-           _compute_sliding_piece_positive_ray(src, SOUTH, piece_to_ignore) |
-           _compute_sliding_piece_negative_ray(src, WEST, piece_to_ignore) |
-           _compute_sliding_piece_negative_ray(src, NORTH, piece_to_ignore);
+    return _get_line_attacks(_count_trailing_zeros(src), all_pieces_mask ^ piece_to_ignore);
 }
 
-uint64_t
-Board::_compute_sliding_piece_positive_ray(uint64_t src, ray_dir_e dir, uint64_t piece_to_ignore)
+uint64_t Board::_get_diagonal_attacks(int src_lkt_i, uint64_t occupancy)
 {
-    int      src_lkt_i = _count_trailing_zeros(src);
-    uint64_t attacks = sliding_lookup[src_lkt_i][dir];
-
-    uint64_t blockers = attacks & (all_pieces_mask ^ piece_to_ignore);
-    if (blockers)
-    {
-        int src_lkt_i = _count_trailing_zeros(blockers);
-
-        attacks ^= sliding_lookup[src_lkt_i][dir];
-    }
+    return _compute_sliding_piece_positive_ray(src_lkt_i, SOUTHEAST, occupancy) |
+           _compute_sliding_piece_positive_ray(src_lkt_i, SOUTHWEST, occupancy) |
+           _compute_sliding_piece_negative_ray(src_lkt_i, NORTHWEST, occupancy) |
+           _compute_sliding_piece_negative_ray(src_lkt_i, NORTHEAST, occupancy);
+}
 
-    return attacks;
+uint64_t Board::_get_line_attacks(int src_lkt_i, uint64_t occupancy)
+{
+    return _compute_sliding_piece_positive_ray(src_lkt_i, EAST, occupancy) |
+           _compute_sliding_piece_positive_ray(src_lkt_i, SOUTH, occupancy) |
+           _compute_sliding_piece_negative_ray(src_lkt_i, WEST, occupancy) |
+           _compute_sliding_piece_negative_ray(src_lkt_i, NORTH, occupancy);
 }
 
 uint64_t
-Board::_compute_sliding_piece_negative_ray(uint64_t src, ray_dir_e dir, uint64_t piece_to_ignore)
+Board::_compute_sliding_piece_positive_ray(int src_lkt_i, ray_dir_e dir, uint64_t occupancy)
 {
-    int      src_lkt_i = _count_trailing_zeros(src);
     uint64_t attacks = sliding_lookup[src_lkt_i][dir];
 
-    uint64_t blockers = attacks & (all_pieces_mask ^ piece_to_ignore);
+    uint64_t blockers = attacks & occupancy;
     if (blockers)
-    {
-        uint64_t blocker = _get_most_significant_bit(blockers);
-        int      src_lkt_i = _count_trailing_zeros(blocker);
-
-        attacks ^= sliding_lookup[src_lkt_i][dir];
-    }
+        attacks ^= sliding_lookup[_count_trailing_zeros(blockers)][dir];
 
     return attacks;
 }
 
-void Board::_compute_sliding_piece_positive_ray_checks_and_pins(
-    uint64_t king_pos, ray_dir_e dir, uint64_t potential_attacker
-)
-{
-    int      king_lkt_i = _count_trailing_zeros(king_pos);
-    uint64_t attacks = sliding_lookup[king_lkt_i][dir];
-
-    uint64_t blockers = attacks & all_pieces_mask;
-
-    if (blockers)
-    {
-        uint64_t blocker = _get_least_significant_bit(blockers);
-        int      blocker_lkt_i = _count_trailing_zeros(blocker);
-
-        if (blocker & potential_attacker)
-        {
-            if (check_state)
-                double_check = true;
-            check_state = true;
-
-            uncheck_mask |= attacks ^ sliding_lookup[blocker_lkt_i][dir];
-        }
-
-        else if (blocker & ally_pieces)
-        {
-            blockers ^= blocker;
-            if (blockers)
-            {
-                blocker = _get_least_significant_bit(blockers);
-
-                if (blocker & potential_attacker)
-                {
-                    int      second_blocker_lkt_i = _count_trailing_zeros(blocker);
-                    uint64_t pin_ray = attacks ^ sliding_lookup[second_blocker_lkt_i][dir];
-
-                    pin_masks[blocker_lkt_i] = pin_ray;
-                }
-            }
-        }
-    }
-}
-
-void Board::_compute_sliding_piece_negative_ray_checks_and_pins(
-    uint64_t king_pos, ray_dir_e dir, uint64_t potential_attacker
-)
-{
-    int      king_lkt_i = _count_trailing_zeros(king_pos);
-    uint64_t attacks = sliding_lookup[king_lkt_i][dir];
-
-    uint64_t blockers = attacks & all_pieces_mask;
-
-    if (blockers)
-    {
-        uint64_t blocker = _get_most_significant_bit(blockers);
-        int      blocker_lkt_i = _count_trailing_zeros(blocker);
-
-        if (blocker & potential_attacker)
-        {
-            if (check_state)
-                double_check = true;
-            check_state = true;
-
-            uncheck_mask |= attacks ^ sliding_lookup[blocker_lkt_i][dir];
-        }
-
-        else if (blocker & ally_pieces)
-        {
-            blockers ^= blocker;
-            if (blockers)
-            {
-                blocker = _get_most_significant_bit(blockers);
-
-                if (blocker & potential_attacker)
-                {
-                    int      second_blocker_lkt_i = _count_trailing_zeros(blocker);
-                    uint64_t pin_ray = attacks ^ sliding_lookup[second_blocker_lkt_i][dir];
-
-                    pin_masks[blocker_lkt_i] = pin_ray;
-                }
-            }
-        }
-    }
-}
-
-bool Board::_is_sliding_piece_positive_diagonal_ray_behind(uint64_t pawn_pos, ray_dir_e dir)
-{
-    int      pawn_lkt_i = _count_trailing_zeros(pawn_pos);
-    uint64_t attacks = sliding_lookup[pawn_lkt_i][dir];
-
-    uint64_t blockers = attacks & all_pieces_mask;
-    if (blockers)
-    {
-        uint64_t blocker = _get_least_significant_bit(blockers);
-
-        if (blocker & enemy_pieces_sliding_diag)
-            return true;
-    }
-
-    return false;
-}
-
-bool Board::_is_sliding_piece_negative_diagonal_ray_behind(uint64_t pawn_pos, ray_dir_e dir)
+uint64_t
+Board::_compute_sliding_piece_negative_ray(int src_lkt_i, ray_dir_e dir, uint64_t occupancy)
 {
-    int      pawn_lkt_i = _count_trailing_zeros(pawn_pos);
-    uint64_t attacks = sliding_lookup[pawn_lkt_i][dir];
+    uint64_t attacks = sliding_lookup[src_lkt_i][dir];
 
-    uint64_t blockers = attacks & all_pieces_mask;
+    uint64_t blockers = attacks & occupancy;
     if (blockers)
-    {
-        uint64_t blocker = _get_most_significant_bit(blockers);
-
-        if (blocker & enemy_pieces_sliding_diag)
-            return true;
-    }
+        attacks ^= sliding_lookup[_count_trailing_zeros(_get_most_significant_bit(blockers))][dir];
 
-    return false;
+    return attacks;
 }
 
 uint64_t Board::_compute_castling_positive_path(uint64_t src, uint64_t dst)
@@ -2514,9 +3413,7 @@ float Board::_compute_game_state()
             return DRAW;
     }
 
-    vector<Move> moves = get_available_moves();
-
-    if (moves.size() == 0)
+    if (!_has_legal_moves())
     {
         if (get_check_state())
             return white_turn ? BLACK_WIN : WHITE_WIN;
@@ -2528,17 +3425,18 @@ float Board::_compute_game_state()
 
 bool Board::_threefold_repetition_rule()
 {
-    int    actual_fen_index = fen_history_index - 1;
-    string actual_fen = fen_history[actual_fen_index];
+    int      actual_position_index = position_history_index - 1;
+    uint64_t actual_position = position_history[actual_position_index];
 
-    bool fen_found = false;
+    bool position_found = false;
     int  history_index = -1;
-    while (++history_index < FEN_HISTORY_SIZE)
-        if (history_index != actual_fen_index && fen_history[history_index] == actual_fen)
+    while (++history_index < POSITION_HISTORY_SIZE)
+        if (history_index != actual_position_index &&
+            position_history[history_index] == actual_position)
         {
-            if (fen_found)
+            if (position_found)
                 return true;
-            fen_found = true;
+            position_found = true;
         }
 
     return false;
@@ -2546,24 +3444,25 @@ bool Board::_threefold_repetition_rule()
 
 bool Board::_insufficient_material_rule()
 {
-    if (white_pawns | black_pawns | white_rooks | black_rooks | white_queens | black_queens)
+    if (white_pawns() | black_pawns() | white_rooks() | black_rooks() | white_queens() |
+        black_queens())
         return false;
 
-    int white_knights_count = _count_bits(white_knights);
-    int black_knights_count = _count_bits(black_knights);
+    int white_knights_count = _count_bits(white_knights());
+    int black_knights_count = _count_bits(black_knights());
     int knights_count = white_knights_count + black_knights_count;
 
     if (knights_count > 1)
         return false;
 
-    int white_bishops_count = _count_bits(white_bishops);
-    int black_bishops_count = _count_bits(black_bishops);
+    int white_bishops_count = _count_bits(white_bishops());
+    int black_bishops_count = _count_bits(black_bishops());
     int bishops_count = white_bishops_count + black_bishops_count;
 
     if (knights_count == 1 && bishops_count > 0)
         return false;
 
-    uint64_t all_bishops = white_bishops | black_bishops;
+    uint64_t all_bishops = white_bishops() | black_bishops();
     if ((all_bishops & BITMASK_WHITE_CELLS) && (all_bishops & BITMASK_BLACK_CELLS))
         return false;
 
@@ -2575,175 +3474,584 @@ bool Board::operator==(Board *test_board_abstracted)
     return this->create_fen() == test_board_abstracted->create_fen();
 }
 
-void Board::_initialize_lookup_tables()
+constexpr std::array<std::array<uint64_t, 2>, 64> Board::_create_pawn_captures_lookup_table()
 {
-    memset(pawn_captures_lookup, 0, sizeof(uint64_t) * 64 * 2);
-    memset(knight_lookup, 0, sizeof(uint64_t) * 64);
-    memset(sliding_lookup, 0, sizeof(uint64_t) * 64 * 8);
-    memset(king_lookup, 0, sizeof(uint64_t) * 64);
+    std::array<std::array<uint64_t, 2>, 64> lookup{};
 
-    int      lkt_i = 0;
-    uint64_t pos_mask = 1UL;
-    for (int y = 0; y < 8; y++)
+    for (int lkt_i = 0; lkt_i < 64; lkt_i++)
     {
-        for (int x = 0; x < 8; x++)
+        int      y = lkt_i / 8;
+        int      x = lkt_i % 8;
+        uint64_t position = 1UL << lkt_i;
+        uint64_t pawn_mask = 0UL;
+
+        if (x > 0 && y > 0)
+            pawn_mask |= (position >> 9);
+        if (x < 7 && y > 0)
+            pawn_mask |= (position >> 7);
+
+        lookup[lkt_i][0] = pawn_mask;
+
+        pawn_mask = 0UL;
+
+        if (x > 0 && y < 7)
+            pawn_mask |= position << 7;
+        if (x < 7 && y < 7)
+            pawn_mask |= position << 9;
+
+        lookup[lkt_i][1] = pawn_mask;
+    }
+
+    return lookup;
+}
+
+constexpr std::array<uint64_t, 64> Board::_create_knight_lookup_table()
+{
+    std::array<uint64_t, 64> lookup{};
+
+    for (int lkt_i = 0; lkt_i < 64; lkt_i++)
+    {
+        int      y = lkt_i / 8;
+        int      x = lkt_i % 8;
+        uint64_t position = 1UL << lkt_i;
+        uint64_t knight_mask = 0UL;
+
+        if (y > 0)
+        {
+            if (x > 1)
+                knight_mask |= position >> 10;
+            if (x < 6)
+                knight_mask |= position >> 6;
+        }
+        if (y > 1)
+        {
+            if (x > 0)
+                knight_mask |= position >> 17;
+            if (x < 7)
+                knight_mask |= position >> 15;
+        }
+        if (y < 6)
+        {
+            if (x > 0)
+                knight_mask |= position << 15;
+            if (x < 7)
+                knight_mask |= position << 17;
+        }
+        if (y < 7)
         {
-            _create_pawn_captures_lookup_table(y, x, pos_mask, lkt_i);
-            _create_knight_lookup_table(y, x, pos_mask, lkt_i);
-            _create_sliding_lookup_table(y, x, pos_mask, lkt_i);
-            _create_king_lookup_table(y, x, pos_mask, lkt_i);
-            lkt_i++;
-            pos_mask <<= 1;
+            if (x > 1)
+                knight_mask |= position << 6;
+            if (x < 6)
+                knight_mask |= position << 10;
         }
+
+        lookup[lkt_i] = knight_mask;
     }
 
-    Board::lookup_tables_initialized = true;
+    return lookup;
 }
 
-void Board::_create_pawn_captures_lookup_table(int y, int x, uint64_t position, int lkt_i)
+constexpr std::array<std::array<uint64_t, 8>, 64> Board::_create_sliding_lookup_table()
 {
+    std::array<std::array<uint64_t, 8>, 64> lookup{};
+
+    for (int lkt_i = 0; lkt_i < 64; lkt_i++)
+    {
+        int      y = lkt_i / 8;
+        int      x = lkt_i % 8;
+        uint64_t position = 1UL << lkt_i;
+
+        uint64_t sliding_pos = position;
+        for (int j = y - 1; j >= 0; j--)
+        {
+            sliding_pos >>= 8;
+            lookup[lkt_i][NORTH] |= sliding_pos;
+        }
+
+        sliding_pos = position;
+        for (int j = y - 1, i = x + 1; j >= 0 && i < 8; j--, i++)
+        {
+            sliding_pos >>= 7;
+            lookup[lkt_i][NORTHEAST] |= sliding_pos;
+        }
+
+        sliding_pos = position;
+        for (int i = x + 1; i < 8; i++)
+        {
+            sliding_pos <<= 1;
+            lookup[lkt_i][EAST] |= sliding_pos;
+        }
 
-    uint64_t pawn_mask = 0UL;
+        sliding_pos = position;
+        for (int j = y + 1, i = x + 1; j < 8 && i < 8; j++, i++)
+        {
+            sliding_pos <<= 9;
+            lookup[lkt_i][SOUTHEAST] |= sliding_pos;
+        }
 
-    if (x > 0 && y > 0)
-        pawn_mask |= (position >> 9);
-    if (x < 7 && y > 0)
-        pawn_mask |= (position >> 7);
+        sliding_pos = position;
+        for (int j = y + 1; j < 8; j++)
+        {
+            sliding_pos <<= 8;
+            lookup[lkt_i][SOUTH] |= sliding_pos;
+        }
 
-    pawn_captures_lookup[lkt_i][0] = pawn_mask;
+        sliding_pos = position;
+        for (int j = y + 1, i = x - 1; j < 8 && i >= 0; j++, i--)
+        {
+            sliding_pos <<= 7;
+            lookup[lkt_i][SOUTHWEST] |= sliding_pos;
+        }
 
-    pawn_mask = 0UL;
+        sliding_pos = position;
+        for (int i = x - 1; i >= 0; i--)
+        {
+            sliding_pos >>= 1;
+            lookup[lkt_i][WEST] |= sliding_pos;
+        }
 
-    if (x > 0 && y < 7)
-        pawn_mask |= position << 7;
-    if (x < 7 && y < 7)
-        pawn_mask |= position << 9;
+        sliding_pos = position;
+        for (int j = y - 1, i = x - 1; j >= 0 && i >= 0; j--, i--)
+        {
+            sliding_pos >>= 9;
+            lookup[lkt_i][NORTHWEST] |= sliding_pos;
+        }
+    }
 
-    pawn_captures_lookup[lkt_i][1] = pawn_mask;
+    return lookup;
 }
 
-void Board::_create_knight_lookup_table(int y, int x, uint64_t position, int lkt_i)
+constexpr std::array<uint64_t, 64> Board::_create_king_lookup_table()
 {
-    uint64_t knight_mask = 0UL;
+    std::array<uint64_t, 64> lookup{};
 
-    if (y > 0)
-    {
-        if (x > 1)
-            knight_mask |= position >> 10;
-        if (x < 6)
-            knight_mask |= position >> 6;
-    }
-    if (y > 1)
-    {
-        if (x > 0)
-            knight_mask |= position >> 17;
-        if (x < 7)
-            knight_mask |= position >> 15;
-    }
-    if (y < 6)
+    for (int lkt_i = 0; lkt_i < 64; lkt_i++)
     {
+        int      y = lkt_i / 8;
+        int      x = lkt_i % 8;
+        uint64_t position = 1UL << lkt_i;
+        uint64_t king_mask = 0UL;
+
         if (x > 0)
-            knight_mask |= position << 15;
+        {
+            if (y > 0)
+                king_mask |= position >> 9;
+            king_mask |= position >> 1;
+            if (y < 7)
+                king_mask |= position << 7;
+        }
         if (x < 7)
-            knight_mask |= position << 17;
-    }
-    if (y < 7)
-    {
-        if (x > 1)
-            knight_mask |= position << 6;
-        if (x < 6)
-            knight_mask |= position << 10;
+        {
+            if (y > 0)
+                king_mask |= position >> 7;
+            king_mask |= position << 1;
+            if (y < 7)
+                king_mask |= position << 9;
+        }
+        if (y > 0)
+            king_mask |= position >> 8;
+        if (y < 7)
+            king_mask |= position << 8;
+
+        lookup[lkt_i] = king_mask;
     }
 
-    knight_lookup[lkt_i] = knight_mask;
+    return lookup;
 }
 
-void Board::_create_sliding_lookup_table(int y, int x, uint64_t position, int lkt_i)
+constexpr std::array<std::array<uint64_t, 64>, 64> Board::_create_between_lookup_table()
 {
-    uint64_t sliding_pos = position;
-    for (int j = y - 1; j >= 0; j--)
-    {
-        sliding_pos >>= 8;
-        sliding_lookup[lkt_i][NORTH] |= sliding_pos;
-    }
+    std::array<std::array<uint64_t, 8>, 64>  sliding = _create_sliding_lookup_table();
+    std::array<std::array<uint64_t, 64>, 64> lookup{};
 
-    sliding_pos = position;
-    for (int j = y - 1, i = x + 1; j >= 0 && i < 8; j--, i++)
+    for (int src_lkt_i = 0; src_lkt_i < 64; src_lkt_i++)
     {
-        sliding_pos >>= 7;
-        sliding_lookup[lkt_i][NORTHEAST] |= sliding_pos;
+        for (int dir = NORTH; dir <= NORTHWEST; dir++)
+        {
+            uint64_t ray = sliding[src_lkt_i][dir];
+            for (int dst_lkt_i = 0; dst_lkt_i < 64; dst_lkt_i++)
+            {
+                if (ray & (1UL << dst_lkt_i))
+                    lookup[src_lkt_i][dst_lkt_i] =
+                        ray ^ sliding[dst_lkt_i][dir] ^ (1UL << dst_lkt_i);
+            }
+        }
     }
 
-    sliding_pos = position;
-    for (int i = x + 1; i < 8; i++)
-    {
-        sliding_pos <<= 1;
-        sliding_lookup[lkt_i][EAST] |= sliding_pos;
-    }
+    return lookup;
+}
 
-    sliding_pos = position;
-    for (int j = y + 1, i = x + 1; j < 8 && i < 8; j++, i++)
-    {
-        sliding_pos <<= 9;
-        sliding_lookup[lkt_i][SOUTHEAST] |= sliding_pos;
-    }
+constexpr std::array<std::array<uint64_t, 64>, 15> Board::_create_zobrist_lookup_table()
+{
+    std::array<std::array<uint64_t, 64>, 15> lookup{};
 
-    sliding_pos = position;
-    for (int j = y + 1; j < 8; j++)
+    // SplitMix64 sequence, with a fixed seed so keys are the same from one build to another
+    uint64_t state = 0;
+    for (int row = 0; row < 15; row++)
     {
-        sliding_pos <<= 8;
-        sliding_lookup[lkt_i][SOUTH] |= sliding_pos;
+        for (int lkt_i = 0; lkt_i < 64; lkt_i++)
+        {
+            uint64_t z = (state += 0x9E3779B97F4A7C15UL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+            lookup[row][lkt_i] = z ^ (z >> 31);
+        }
     }
 
-    sliding_pos = position;
-    for (int j = y + 1, i = x - 1; j < 8 && i >= 0; j++, i--)
+    return lookup;
+}
+
+constexpr std::array<std::array<uint64_t, 2>, 64> Board::pawn_captures_lookup =
+    Board::_create_pawn_captures_lookup_table();
+constexpr std::array<uint64_t, 64> Board::knight_lookup = Board::_create_knight_lookup_table();
+constexpr std::array<std::array<uint64_t, 8>, 64> Board::sliding_lookup =
+    Board::_create_sliding_lookup_table();
+constexpr std::array<uint64_t, 64> Board::king_lookup = Board::_create_king_lookup_table();
+constexpr std::array<std::array<uint64_t, 64>, 64> Board::between_lookup =
+    Board::_create_between_lookup_table();
+constexpr std::array<std::array<uint64_t, 64>, 15> Board::zobrist_lookup =
+    Board::_create_zobrist_lookup_table();
+
+/*
+        Content of 'srcs/chessengine/Nnue.cpp'
+*/
+
+#if USE_NNUE == 1
+
+// Bootstrap network, until one is trained on self-play data: each of the first 12 hidden units
+// sums the material and start game bonuses of a piece type of one side, as in PiecesHeuristic
+// clang-format off
+static const char *nnue_weights_base64 =
+    "GQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAA"
+    "AAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAA"
+    "AAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAA"
+    "AAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAA"
+    "AAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAAB"
+    "kAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAA"
+    "AAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAA"
+    "AAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAeAAAA"
+    "AAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAA"
+    "AAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZ"
+    "AAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGgAAAAAAAA"
+    "AAAAAAAAAAABoAAAAAAAAAAAAAAAAAAAAaAAAAAAAAAAAAAAAAAAAAFAAAAAAAAAAAAAAAAAAAABQAAAAAAAAAAAAAAAAA"
+    "AAAaAAAAAAAAAAAAAAAAAAAAGgAAAAAAAAAAAAAAAAAAABoAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAA"
+    "AAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAA"
+    "AAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAXwAAAAAAAAAAAAAAAAAAAG"
+    "IAAAAAAAAAAAAAAAAAAABiAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAGIAAAAAAAAAAAAAAAAAAABfAAAAAAAA"
+    "AAAAAAAAAAAAXwAAAAAAAAAAAAAAAAAAAF8AAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAZgAAAAAAAAAAAAAAAA"
+    "AAAGcAAAAAAAAAAAAAAAAAAABnAAAAAAAAAAAAAAAAAAAAZgAAAAAAAAAAAAAAAAAAAF8AAAAAAAAAAAAAAAAAAABfAAAA"
+    "AAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAGcAAAAAAAAAAAAAAAAAAABpAAAAAAAAAAAAAAAAAAAAawAAAAAAAAAAAA"
+    "AAAAAAAGsAAAAAAAAAAAAAAAAAAABpAAAAAAAAAAAAAAAAAAAAZwAAAAAAAAAAAAAAAAAAAGIAAAAAAAAAAAAAAAAAAABi"
+    "AAAAAAAAAAAAAAAAAAAAZwAAAAAAAAAAAAAAAAAAAGsAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAA"
+    "AAAAAAAAAAAGsAAAAAAAAAAAAAAAAAAABnAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAGIAAAAAAAAAAAAAAAAA"
+    "AABnAAAAAAAAAAAAAAAAAAAAawAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAawAAAA"
+    "AAAAAAAAAAAAAAAGcAAAAAAAAAAAAAAAAAAABiAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAGcAAAAAAAAAAAAA"
+    "AAAAAABpAAAAAAAAAAAAAAAAAAAAawAAAAAAAAAAAAAAAAAAAGsAAAAAAAAAAAAAAAAAAABpAAAAAAAAAAAAAAAAAAAAZw"
+    "AAAAAAAAAAAAAAAAAAAGIAAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAXwAAAAAAAAAAAAAAAAAAAGYAAAAAAAAA"
+    "AAAAAAAAAABmAAAAAAAAAAAAAAAAAAAAZgAAAAAAAAAAAAAAAAAAAGYAAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAA"
+    "AAXwAAAAAAAAAAAAAAAAAAAF8AAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAGIAAAAA"
+    "AAAAAAAAAAAAAABiAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAF8AAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAA"
+    "AAAAAAAGgAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABs"
+    "AAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABoAAAAAAAAAAAAAAAAAAAAbAAAAAAAAA"
+    "AAAAAAAAAAAG8AAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAG8AAAAAAAAAAAAAAAAA"
+    "AABvAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbwAAAA"
+    "AAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAA"
+    "AAAAAABvAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAcQ"
+    "AAAAAAAAAAAAAAAAAAAHIAAAAAAAAAAAAAAAAAAAByAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAG8AAAAAAAAA"
+    "AAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAG8AAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAA"
+    "AAcgAAAAAAAAAAAAAAAAAAAHIAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAGwAAAAA"
+    "AAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAA"
+    "AAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwA"
+    "AAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAG8AAAAAAAAAAAAAAAAAAABvAAAAAAAAAA"
+    "AAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAG8AAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAaAAAAAAAAAAAAAAAAAAA"
+    "AGwAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABsAAAAAA"
+    "AAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGgAAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAA"
+    "AAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQ"
+    "AAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAAByAAAAAAAAAAAAAAAAAAAAcwAAAAAAAAAAAAAAAAAAAHMAAAAAAAAA"
+    "AAAAAAAAAABzAAAAAAAAAAAAAAAAAAAAcwAAAAAAAAAAAAAAAAAAAHMAAAAAAAAAAAAAAAAAAABzAAAAAAAAAAAAAAAAAA"
+    "AAcgAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAA"
+    "AAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABwAAAAAAAAAAAAAA"
+    "AAAAAAcAAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEA"
+    "AAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAABwAAAAAAAAAA"
+    "AAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAA"
+    "AHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcAAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAABxAAAAAA"
+    "AAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAA"
+    "AAAAAHEAAAAAAAAAAAAAAAAAAABwAAAAAAAAAAAAAAAAAAAAcAAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAA"
+    "AAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAA"
+    "AAAAAAAAAHAAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHMAAAAAAAAAAAAAAAAAAA"
+    "BzAAAAAAAAAAAAAAAAAAAAcwAAAAAAAAAAAAAAAAAAAHMAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAA"
+    "AAAAAAAAAAAAAAB0AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAA"
+    "AAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdAAAAAAAAAAAAAAAAAAAAHYA"
+    "AAAAAAAAAAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB3AAAAAAAAAA"
+    "AAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAA"
+    "AHcAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAA"
+    "AAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAA"
+    "AAAAAHgAAAAAAAAAAAAAAAAAAAB5AAAAAAAAAAAAAAAAAAAAeQAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB3AA"
+    "AAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAA"
+    "AAAAAAAAAHkAAAAAAAAAAAAAAAAAAAB5AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAA"
+    "B2AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAA"
+    "AAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAA"
+    "AAAAB2AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAdwAA"
+    "AAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHQAAAAAAAAAAA"
+    "AAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAA"
+    "dgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB0AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+    "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+    "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAACgAAAAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAA"
+    "AAAAAAAAAAAAAAAAAACgAAAAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAAAAAAAAAAAAAAAAAAAACgAAAAAAAAAA"
+    "AAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAUAAAAAAAAAAAAAAAAAAAAFAAAAAAAAAAAAAAAAAAAABQAAAAAAAAAAAAAAAAAAA"
+    "AUAAAAAAAAAAAAAAAAAAAAFAAAAAAAAAAAAAAAAAAAABQAAAAAAAAAAAAAAAAAAAAUAAAAAAAAAAAAAAAAAAAAFAAAAAAA"
+    "AAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAA"
+    "AAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAKAAA"
+    "AAAAAAAAAAAAAAAAACgAAAAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAAAAAAAAAAAAAAAAAAAACgAAAAAAAAAAA"
+    "AAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAAAAAAAAAAAAAAAAAAAACgAAAAAAAAAAAAAAAAAAAAyAAAAAAAAAAAAAAAAAAAA"
+    "MgAAAAAAAAAAAAAAAAAAADIAAAAAAAAAAAAAAAAAAAAyAAAAAAAAAAAAAAAAAAAAMgAAAAAAAAAAAAAAAAAAADIAAAAAAA"
+    "AAAAAAAAAAAAAyAAAAAAAAAAAAAAAAAAAAMgAAAAAAAAAAAAAAAAAAADwAAAAAAAAAAAAAAAAAAAA8AAAAAAAAAAAAAAAA"
+    "AAAAPAAAAAAAAAAAAAAAAAAAADwAAAAAAAAAAAAAAAAAAAA8AAAAAAAAAAAAAAAAAAAAPAAAAAAAAAAAAAAAAAAAADwAAA"
+    "AAAAAAAAAAAAAAAAA8AAAAAAAAAAAAAAAAAAAAQQAAAAAAAAAAAAAAAAAAAEEAAAAAAAAAAAAAAAAAAABaAAAAAAAAAAAA"
+    "AAAAAAAAPAAAAAAAAAAAAAAAAAAAADwAAAAAAAAAAAAAAAAAAAA8AAAAAAAAAAAAAAAAAAAAWgAAAAAAAAAAAAAAAAAAAE"
+    "EAAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAA"
+    "AAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAA"
+    "AAAAAaAAAAAAAAAAAAAAAAAAAAGgAAAAAAAAAAAAAAAAAAABoAAAAAAAAAAAAAAAAAAAAUAAAAAAAAAAAAAAAAAAAAFAAA"
+    "AAAAAAAAAAAAAAAAABoAAAAAAAAAAAAAAAAAAAAaAAAAAAAAAAAAAAAAAAAAGgAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAA"
+    "AAAAAAAAAZAAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAA"
+    "HAAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAA"
+    "AAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAA"
+    "AAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAA"
+    "AAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAA"
+    "AAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAAB"
+    "kAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAA"
+    "AAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAA"
+    "AAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAZAAAA"
+    "AAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAA"
+    "AAAAAAABkAAAAAAAAAAAAAAAAAAAAZAAAAAAAAAAAAAAAAAAAAGQAAAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAA"
+    "XwAAAAAAAAAAAAAAAAAAAGIAAAAAAAAAAAAAAAAAAABiAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAGIAAAAAAA"
+    "AAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAXwAAAAAAAAAAAAAAAAAAAF8AAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAA"
+    "AAAAZgAAAAAAAAAAAAAAAAAAAGYAAAAAAAAAAAAAAAAAAABmAAAAAAAAAAAAAAAAAAAAZgAAAAAAAAAAAAAAAAAAAF8AAA"
+    "AAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAGcAAAAAAAAAAAAAAAAAAABpAAAAAAAAAAAA"
+    "AAAAAAAAawAAAAAAAAAAAAAAAAAAAGsAAAAAAAAAAAAAAAAAAABpAAAAAAAAAAAAAAAAAAAAZwAAAAAAAAAAAAAAAAAAAG"
+    "IAAAAAAAAAAAAAAAAAAABiAAAAAAAAAAAAAAAAAAAAZwAAAAAAAAAAAAAAAAAAAGsAAAAAAAAAAAAAAAAAAABsAAAAAAAA"
+    "AAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGsAAAAAAAAAAAAAAAAAAABnAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAA"
+    "AAAGIAAAAAAAAAAAAAAAAAAABnAAAAAAAAAAAAAAAAAAAAawAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABsAAAA"
+    "AAAAAAAAAAAAAAAAawAAAAAAAAAAAAAAAAAAAGcAAAAAAAAAAAAAAAAAAABiAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAA"
+    "AAAAAAAGcAAAAAAAAAAAAAAAAAAABpAAAAAAAAAAAAAAAAAAAAawAAAAAAAAAAAAAAAAAAAGsAAAAAAAAAAAAAAAAAAABp"
+    "AAAAAAAAAAAAAAAAAAAAZwAAAAAAAAAAAAAAAAAAAGIAAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAXwAAAAAAAA"
+    "AAAAAAAAAAAGYAAAAAAAAAAAAAAAAAAABnAAAAAAAAAAAAAAAAAAAAZwAAAAAAAAAAAAAAAAAAAGYAAAAAAAAAAAAAAAAA"
+    "AABfAAAAAAAAAAAAAAAAAAAAXwAAAAAAAAAAAAAAAAAAAF8AAAAAAAAAAAAAAAAAAABfAAAAAAAAAAAAAAAAAAAAYgAAAA"
+    "AAAAAAAAAAAAAAAGIAAAAAAAAAAAAAAAAAAABiAAAAAAAAAAAAAAAAAAAAYgAAAAAAAAAAAAAAAAAAAF8AAAAAAAAAAAAA"
+    "AAAAAABfAAAAAAAAAAAAAAAAAAAAAGgAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAG"
+    "wAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABoAAAAAAAA"
+    "AAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAG8AAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAA"
+    "AAAG8AAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABsAAAA"
+    "AAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAA"
+    "AAAAAAAHEAAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABv"
+    "AAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHIAAAAAAAAAAAAAAAAAAAByAAAAAAAAAAAAAAAAAAAAcQAAAAAAAA"
+    "AAAAAAAAAAAG8AAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAG8AAAAAAAAAAAAAAAAA"
+    "AABxAAAAAAAAAAAAAAAAAAAAcgAAAAAAAAAAAAAAAAAAAHIAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAbwAAAA"
+    "AAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAA"
+    "AAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbA"
+    "AAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAG8AAAAAAAAA"
+    "AAAAAAAAAABvAAAAAAAAAAAAAAAAAAAAbwAAAAAAAAAAAAAAAAAAAG8AAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAA"
+    "AAaAAAAAAAAAAAAAAAAAAAAGwAAAAAAAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGwAAAAA"
+    "AAAAAAAAAAAAAABsAAAAAAAAAAAAAAAAAAAAbAAAAAAAAAAAAAAAAAAAAGgAAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAA"
+    "AAAAAAAHEAAAAAAAAAAAAAAAAAAABzAAAAAAAAAAAAAAAAAAAAcwAAAAAAAAAAAAAAAAAAAHMAAAAAAAAAAAAAAAAAAABz"
+    "AAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABwAAAAAAAAAAAAAAAAAAAAcQAAAAAAAA"
+    "AAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAA"
+    "AABxAAAAAAAAAAAAAAAAAAAAcAAAAAAAAAAAAAAAAAAAAHAAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAA"
+    "AAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAA"
+    "AAAAAABwAAAAAAAAAAAAAAAAAAAAcAAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQ"
+    "AAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHAAAAAAAAAA"
+    "AAAAAAAAAABwAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAA"
+    "AAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcAAAAAAAAAAAAAAAAAAAAHAAAAAA"
+    "AAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAA"
+    "AAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABwAAAAAAAAAAAAAAAAAAAAcgAAAAAAAAAAAAAAAAAAAHMA"
+    "AAAAAAAAAAAAAAAAAABzAAAAAAAAAAAAAAAAAAAAcwAAAAAAAAAAAAAAAAAAAHMAAAAAAAAAAAAAAAAAAABzAAAAAAAAAA"
+    "AAAAAAAAAAcwAAAAAAAAAAAAAAAAAAAHIAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAA"
+    "AHEAAAAAAAAAAAAAAAAAAABxAAAAAAAAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAHEAAAAAAAAAAAAAAAAAAABxAAAAAA"
+    "AAAAAAAAAAAAAAcQAAAAAAAAAAAAAAAAAAAAB0AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAA"
+    "AAAAAAB2AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdA"
+    "AAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHcAAAAAAAAA"
+    "AAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAA"
+    "AAdgAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAA"
+    "AAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAA"
+    "AAAAAAdwAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB5AAAAAAAAAAAAAAAAAAAAeQAAAAAAAAAAAAAAAAAAAHgA"
+    "AAAAAAAAAAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB3AAAAAAAAAA"
+    "AAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHkAAAAAAAAAAAAAAAAAAAB5AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAA"
+    "AHcAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB4AAAAAA"
+    "AAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAA"
+    "AAAAAHYAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB3AA"
+    "AAAAAAAAAAAAAAAAAAdwAAAAAAAAAAAAAAAAAAAHcAAAAAAAAAAAAAAAAAAAB3AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAA"
+    "AAAAAAAAAHQAAAAAAAAAAAAAAAAAAAB2AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAA"
+    "B2AAAAAAAAAAAAAAAAAAAAdgAAAAAAAAAAAAAAAAAAAHYAAAAAAAAAAAAAAAAAAAB0AAAAAAAAAAAAAAAAAAAAAEEAAAAA"
+    "AAAAAAAAAAAAAABBAAAAAAAAAAAAAAAAAAAAWgAAAAAAAAAAAAAAAAAAADwAAAAAAAAAAAAAAAAAAAA8AAAAAAAAAAAAAA"
+    "AAAAAAPAAAAAAAAAAAAAAAAAAAAFoAAAAAAAAAAAAAAAAAAABBAAAAAAAAAAAAAAAAAAAAPAAAAAAAAAAAAAAAAAAAADwA"
+    "AAAAAAAAAAAAAAAAAAA8AAAAAAAAAAAAAAAAAAAAPAAAAAAAAAAAAAAAAAAAADwAAAAAAAAAAAAAAAAAAAA8AAAAAAAAAA"
+    "AAAAAAAAAAPAAAAAAAAAAAAAAAAAAAADwAAAAAAAAAAAAAAAAAAAAyAAAAAAAAAAAAAAAAAAAAMgAAAAAAAAAAAAAAAAAA"
+    "ADIAAAAAAAAAAAAAAAAAAAAyAAAAAAAAAAAAAAAAAAAAMgAAAAAAAAAAAAAAAAAAADIAAAAAAAAAAAAAAAAAAAAyAAAAAA"
+    "AAAAAAAAAAAAAAMgAAAAAAAAAAAAAAAAAAACgAAAAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAAAAAAAAAAAAAAA"
+    "AAAAACgAAAAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAAAAAAAAAAAAAAAAAAAACgAAAAAAAAAAAAAAAAAAAAoAA"
+    "AAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAA"
+    "AAAAAAAAAB4AAAAAAAAAAAAAAAAAAAAeAAAAAAAAAAAAAAAAAAAAHgAAAAAAAAAAAAAAAAAAAB4AAAAAAAAAAAAAAAAAAA"
+    "AUAAAAAAAAAAAAAAAAAAAAFAAAAAAAAAAAAAAAAAAAABQAAAAAAAAAAAAAAAAAAAAUAAAAAAAAAAAAAAAAAAAAFAAAAAAA"
+    "AAAAAAAAAAAAABQAAAAAAAAAAAAAAAAAAAAUAAAAAAAAAAAAAAAAAAAAFAAAAAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAA"
+    "AAAAAKAAAAAAAAAAAAAAAAAAAACgAAAAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAAAAAAAAAAAAAAAAAAAACgAA"
+    "AAAAAAAAAAAAAAAAAAoAAAAAAAAAAAAAAAAAAAAKAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+    "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+    "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAgGBgoQAjg6OjYwPgAAAAAAA"
+    "AAAAAAAAAAAAAAAAAAAAAAAAA=";
+// clang-format on
+
+int8_t  Nnue::feature_weights[NNUE_FEATURES_COUNT][NNUE_HIDDEN_SIZE];
+int16_t Nnue::feature_biases[NNUE_HIDDEN_SIZE];
+int8_t  Nnue::output_weights[2][NNUE_HIDDEN_SIZE];
+int32_t Nnue::output_bias;
+
+const bool Nnue::weights_loaded = Nnue::_load_weights();
+const bool Nnue::avx2_supported = __builtin_cpu_supports("avx2");
+
+bool Nnue::_load_weights()
+{
+    const string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    vector<uint8_t> bytes;
+    uint32_t        buffer = 0;
+    int             bits = 0;
+    for (const char *c = nnue_weights_base64; *c && *c != '='; c++)
     {
-        sliding_pos <<= 7;
-        sliding_lookup[lkt_i][SOUTHWEST] |= sliding_pos;
+        buffer = (buffer << 6) | alphabet.find(*c);
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            bytes.push_back((buffer >> bits) & 0xFF);
+        }
     }
 
-    sliding_pos = position;
-    for (int i = x - 1; i >= 0; i--)
+    size_t expected_size = sizeof(feature_weights) + sizeof(feature_biases) +
+                           sizeof(output_weights) + sizeof(output_bias);
+    if (bytes.size() != expected_size)
     {
-        sliding_pos >>= 1;
-        sliding_lookup[lkt_i][WEST] |= sliding_pos;
+        cerr << "Nnue: invalid weights size: " << bytes.size() << "/" << expected_size << endl;
+        return false;
     }
 
-    sliding_pos = position;
-    for (int j = y - 1, i = x - 1; j >= 0 && i >= 0; j--, i--)
+    // Copies are little-endian, as the targeted machines are
+    const uint8_t *data = bytes.data();
+    memcpy(feature_weights, data, sizeof(feature_weights));
+    data += sizeof(feature_weights);
+    memcpy(feature_biases, data, sizeof(feature_biases));
+    data += sizeof(feature_biases);
+    memcpy(output_weights, data, sizeof(output_weights));
+    data += sizeof(output_weights);
+    memcpy(&output_bias, data, sizeof(output_bias));
+
+    return true;
+}
+
+int Nnue::feature_index(int perspective, int piece, int lkt_i)
+{
+    // Each side sees its own pieces first, and its first rank at the bottom of the board
+    int relative_color = piece / 6 == perspective ? 0 : 1;
+    int relative_lkt_i = perspective == WHITE ? lkt_i : lkt_i ^ 56;
+
+    return (relative_color * 6 + piece % 6) * 64 + relative_lkt_i;
+}
+
+void Nnue::initialize_accumulator(int16_t *accumulator)
+{
+    memcpy(accumulator, feature_biases, sizeof(feature_biases));
+}
+
+void Nnue::add_feature(int16_t *accumulator, int feature)
+{
+    if (avx2_supported)
     {
-        sliding_pos >>= 9;
-        sliding_lookup[lkt_i][NORTHWEST] |= sliding_pos;
+        _add_feature_avx2(accumulator, feature_weights[feature]);
+        return;
     }
+
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++)
+        accumulator[i] += feature_weights[feature][i];
 }
 
-void Board::_create_king_lookup_table(int y, int x, uint64_t position, int lkt_i)
+void Nnue::remove_feature(int16_t *accumulator, int feature)
 {
-    uint64_t king_mask = 0UL;
-    if (x > 0)
+    if (avx2_supported)
     {
-        if (y > 0)
-            king_mask |= position >> 9;
-        king_mask |= position >> 1;
-        if (y < 7)
-            king_mask |= position << 7;
+        _remove_feature_avx2(accumulator, feature_weights[feature]);
+        return;
     }
-    if (x < 7)
+
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++)
+        accumulator[i] -= feature_weights[feature][i];
+}
+
+int Nnue::evaluate(const int16_t *ally_accumulator, const int16_t *enemy_accumulator)
+{
+    if (avx2_supported)
+        return _evaluate_avx2(ally_accumulator, enemy_accumulator) / NNUE_OUTPUT_SCALE;
+
+    int output = output_bias;
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++)
     {
-        if (y > 0)
-            king_mask |= position >> 7;
-        king_mask |= position << 1;
-        if (y < 7)
-            king_mask |= position << 9;
+        int ally_activation = min(max((int)ally_accumulator[i], 0), NNUE_ACTIVATION_MAX);
+        int enemy_activation = min(max((int)enemy_accumulator[i], 0), NNUE_ACTIVATION_MAX);
+
+        output += ally_activation * output_weights[0][i] + enemy_activation * output_weights[1][i];
     }
-    if (y > 0)
-        king_mask |= position >> 8;
-    if (y < 7)
-        king_mask |= position << 8;
 
-    king_lookup[lkt_i] = king_mask;
+    return output / NNUE_OUTPUT_SCALE;
+}
+
+/* AVX2 KERNELS: a 16 int16 accumulator fills exactly one register */
+
+__attribute__((target("avx2"))) void
+Nnue::_add_feature_avx2(int16_t *accumulator, const int8_t *weights)
+{
+    __m256i values = _mm256_loadu_si256((const __m256i *)accumulator);
+    __m256i deltas = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)weights));
+
+    _mm256_storeu_si256((__m256i *)accumulator, _mm256_add_epi16(values, deltas));
+}
+
+__attribute__((target("avx2"))) void
+Nnue::_remove_feature_avx2(int16_t *accumulator, const int8_t *weights)
+{
+    __m256i values = _mm256_loadu_si256((const __m256i *)accumulator);
+    __m256i deltas = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)weights));
+
+    _mm256_storeu_si256((__m256i *)accumulator, _mm256_sub_epi16(values, deltas));
+}
+
+__attribute__((target("avx2"))) int
+Nnue::_evaluate_avx2(const int16_t *ally_accumulator, const int16_t *enemy_accumulator)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i activation_max = _mm256_set1_epi16(NNUE_ACTIVATION_MAX);
+
+    __m256i ally = _mm256_loadu_si256((const __m256i *)ally_accumulator);
+    __m256i enemy = _mm256_loadu_si256((const __m256i *)enemy_accumulator);
+    ally = _mm256_min_epi16(_mm256_max_epi16(ally, zero), activation_max);
+    enemy = _mm256_min_epi16(_mm256_max_epi16(enemy, zero), activation_max);
+
+    // Products are summed by pairs in int32, which clipped activations can't overflow
+    __m256i ally_weights =
+        _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)output_weights[0]));
+    __m256i enemy_weights =
+        _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)output_weights[1]));
+    __m256i sums = _mm256_add_epi32(
+        _mm256_madd_epi16(ally, ally_weights), _mm256_madd_epi16(enemy, enemy_weights)
+    );
+
+    __m128i sums_128 =
+        _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    sums_128 = _mm_add_epi32(sums_128, _mm_shuffle_epi32(sums_128, 0x4E));
+    sums_128 = _mm_add_epi32(sums_128, _mm_shuffle_epi32(sums_128, 0xB1));
+
+    return output_bias + _mm_cvtsi128_si32(sums_128);
 }
 
+#endif
+
 /*
         Content of 'srcs/chessengine/Move.cpp'
 */
@@ -2877,6 +4185,148 @@ bool Move::_is_move_in_movelst(Move *move, vector<Move> movelst)
     return false;
 };
 
+/*
+        Content of 'srcs/chessengine/MovePicker.cpp'
+*/
+
+MovePicker::MovePicker(
+    Board *board, Move *hash_move, vector<Move> *killer_moves, bool captures_only
+)
+{
+    this->_board = board;
+    this->_hash_move = hash_move;
+    this->_killer_moves = killer_moves;
+    this->_captures_only = captures_only;
+
+    this->_stage = HASH_MOVE_STAGE;
+    this->_move_index = 0;
+}
+
+bool MovePicker::next_move(Move *move)
+{
+    while (this->_stage != END_STAGE)
+    {
+        if (this->_stage == HASH_MOVE_STAGE)
+        {
+            this->_stage = CAPTURES_STAGE;
+            this->_board->find_pseudo_legal_moves(&this->_moves, true);
+            _sort_captures();
+
+            if (this->_hash_move && this->_board->is_pseudo_legal_move(*this->_hash_move) &&
+                this->_board->is_legal_move(*this->_hash_move))
+            {
+                this->_yielded_moves.push_back(*this->_hash_move);
+                *move = *this->_hash_move;
+                return true;
+            }
+        }
+        else if (this->_move_index < this->_moves.size())
+        {
+            Move &candidate = this->_moves[this->_move_index++];
+
+            if (_is_already_yielded(candidate))
+                continue;
+
+            if (this->_stage == CAPTURES_STAGE && !this->_board->see_ge(candidate, 0))
+            {
+                if (!this->_captures_only)
+                    this->_losing_captures.push_back(candidate);
+                continue;
+            }
+
+            if (this->_board->is_legal_move(candidate))
+            {
+                if (this->_stage == KILLER_MOVES_STAGE)
+                    this->_yielded_moves.push_back(candidate);
+                *move = candidate;
+                return true;
+            }
+        }
+        else if (this->_stage == CAPTURES_STAGE && this->_captures_only)
+            this->_stage = END_STAGE;
+        else if (this->_stage == CAPTURES_STAGE)
+        {
+            this->_stage = KILLER_MOVES_STAGE;
+            this->_moves.clear();
+            this->_move_index = 0;
+
+            // Killers come from sibling nodes, so only the quiet ones valid here are kept
+            if (this->_killer_moves)
+                for (Move &killer : *this->_killer_moves)
+                    if (this->_board->is_pseudo_legal_move(killer) &&
+                        !this->_board->is_capture_move(killer) && !killer.promotion)
+                        this->_moves.push_back(killer);
+        }
+        else if (this->_stage == KILLER_MOVES_STAGE)
+        {
+            this->_stage = QUIET_MOVES_STAGE;
+            this->_moves.clear();
+            this->_move_index = 0;
+
+            this->_board->find_pseudo_legal_moves(&this->_moves, false);
+        }
+        else if (this->_stage == QUIET_MOVES_STAGE)
+        {
+            this->_stage = LOSING_CAPTURES_STAGE;
+            this->_moves.swap(this->_losing_captures);
+            this->_move_index = 0;
+        }
+        else
+            this->_stage = END_STAGE;
+    }
+
+    return false;
+}
+
+bool MovePicker::is_quiet_move_stage()
+{
+    return this->_stage == KILLER_MOVES_STAGE || this->_stage == QUIET_MOVES_STAGE;
+}
+
+void MovePicker::_sort_captures()
+{
+    // MVV-LVA: the most valuable victim first, then the least valuable attacker
+    vector<int> scores;
+    for (Move &move : this->_moves)
+    {
+        int attacker = this->_board->piece_on[_count_trailing_zeros(move.src)] % 6;
+        int victim = this->_board->piece_on[_count_trailing_zeros(move.dst)];
+        int victim_type = victim == NO_PIECE ? PAWN : victim % 6;
+        int promotion_type = move.promotion ? piece_to_index(move.promotion) % 6 : PAWN;
+
+        scores.push_back((victim_type + promotion_type) * 8 - attacker);
+    }
+
+    vector<size_t> order(this->_moves.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&scores](size_t a, size_t b) {
+        return scores[a] > scores[b];
+    });
+
+    vector<Move> sorted_moves;
+    sorted_moves.reserve(this->_moves.size());
+    for (size_t i : order)
+        sorted_moves.push_back(this->_moves[i]);
+    this->_moves.swap(sorted_moves);
+}
+
+bool MovePicker::_is_already_yielded(Move &move)
+{
+    // Only the hash and killer moves actually yielded are filtered : the ones rejected by
+    // is_pseudo_legal_move, like castles, must still come from the regular generation
+    for (Move &yielded : this->_yielded_moves)
+        if (_is_same_move(move, &yielded))
+            return true;
+
+    return false;
+}
+
+bool MovePicker::_is_same_move(Move &move, Move *other)
+{
+    return other && move.src == other->src && move.dst == other->dst &&
+           move.promotion == other->promotion;
+}
+
 /*
         Content of 'srcs/agents/MctsAgent.cpp'
 */
@@ -2914,7 +4364,7 @@ void MctsAgent::get_qualities(Board *board, vector<Move> moves, vector<float> *q
     expand_node(&root_node);
 
     this->_nodes_explored = 0;
-    while (!this->is_time_up())
+    while (!this->is_time_up() && !root_node.is_over)
     {
         float evaluation = this->mcts(&root_node, 0);
 
@@ -2929,7 +4379,23 @@ void MctsAgent::get_qualities(Board *board, vector<Move> moves, vector<float> *q
     int player = board->is_white_turn() ? 1 : -1;
 
     for (size_t i = 0; i < moves.size(); i++)
-        qualities->push_back(player * root_node.children_nodes[i]->visits);
+    {
+        // Children aren't expanded in the order of the moves
+        Node *child = *find_if(
+            root_node.children_nodes.begin(), root_node.children_nodes.end(),
+            [&moves, i](Node *node) {
+                return node->move.src == moves[i].src && node->move.dst == moves[i].dst &&
+                       node->move.promotion == moves[i].promotion;
+            }
+        );
+
+        if (child->is_over && child->end_game_evaluation == 1)
+            qualities->push_back(player * std::numeric_limits<float>::max());
+        else if (child->is_over && child->end_game_evaluation == 0)
+            qualities->push_back(player * -1);
+        else
+            qualities->push_back(player * child->visits);
+    }
 
     float dtime = elapsed_time(this->_start_time);
 
@@ -2946,8 +4412,7 @@ vector<string> MctsAgent::get_stats()
     stats.push_back("depth=" + to_string(this->_depth_reached));
     stats.push_back("states=" + to_string(this->_nodes_explored));
     stats.push_back("winrate=" + to_string(this->_winrate));
-    cerr << "BbMctsPv-rc\t: stats=" << stats[0] << " " << stats[1] << " " << stats[2] << " "
-         << stats[3] << endl;
+    this->_heuristic->log_stats("BbMctsPv-rc", &stats);
 
     return stats;
 }
@@ -2978,8 +4443,7 @@ float MctsAgent::mcts(Node *parent_node, int depth)
         {
             expand_node(node);
 
-            int player = node->resulting_board->is_white_turn() ? -1 : 1;
-            evaluation = (1 + player * this->_heuristic->evaluate(node->resulting_board)) / 2;
+            evaluation = simulation(node);
         }
         else
         {
@@ -2999,6 +4463,9 @@ float MctsAgent::mcts(Node *parent_node, int depth)
     node->utc_exploitation = node->value / node->visits;
     node->utc_parent_exploration = this->_exploration_constant * log(node->visits);
 
+    if (node->is_over)
+        solve_node(parent_node);
+
     return evaluation;
 }
 
@@ -3009,8 +4476,12 @@ Node *MctsAgent::select_child(Node *parent)
         if (child->visits == 0)
             return child;
 
-        child->uct_value =
-            child->utc_exploitation + sqrt(parent->utc_parent_exploration / child->visits);
+        // A child proven lost for the player moving into it is never worth selecting
+        if (child->is_over && child->end_game_evaluation == 0)
+            child->uct_value = -std::numeric_limits<float>::infinity();
+        else
+            child->uct_value =
+                child->utc_exploitation + sqrt(parent->utc_parent_exploration / child->visits);
     }
 
     Node *max_child_it = *max_element(
@@ -3023,10 +4494,61 @@ Node *MctsAgent::select_child(Node *parent)
 
 void MctsAgent::expand_node(Node *node)
 {
-    for (const Move &move : node->resulting_board->get_available_moves())
+    // Unvisited children are selected in order, so captures losing material are tried last
+    Board       *board = node->resulting_board;
+    vector<Move> losing_captures;
+    for (Move &move : board->get_available_moves())
+    {
+        if (board->is_capture_move(move) && !board->see_ge(move, 0))
+            losing_captures.push_back(move);
+        else
+            node->children_nodes.push_back(new Node(move));
+    }
+
+    for (const Move &move : losing_captures)
         node->children_nodes.push_back(new Node(move));
 }
 
+float MctsAgent::simulation(Node *node)
+{
+    int player = node->resulting_board->is_white_turn() ? -1 : 1;
+    return (1 + player * this->_heuristic->evaluate(node->resulting_board)) / 2;
+}
+
+void MctsAgent::solve_node(Node *node)
+{
+    /*
+        MCTS-Solver: children evaluations are from the opponent's point of view.
+        One child proven as a win makes the node a proven loss. Once all children
+        are proven, the node takes the opposite value of the best one.
+    */
+    bool  all_children_over = true;
+    float best_child_evaluation = 0;
+    for (const auto &child : node->children_nodes)
+    {
+        if (!child->is_over)
+        {
+            all_children_over = false;
+            continue;
+        }
+
+        if (child->end_game_evaluation == 1)
+        {
+            node->is_over = true;
+            node->end_game_evaluation = 0;
+            return;
+        }
+
+        best_child_evaluation = max(best_child_evaluation, child->end_game_evaluation);
+    }
+
+    if (all_children_over)
+    {
+        node->is_over = true;
+        node->end_game_evaluation = 1 - best_child_evaluation;
+    }
+}
+
 bool MctsAgent::is_time_up()
 {
     return this->elapsed_time(this->_start_time) >= this->_ms_turn_stop;
@@ -3037,26 +4559,554 @@ float MctsAgent::elapsed_time(clock_t clock_start)
     return (float)(clock() - clock_start) / CLOCKS_PER_SEC * 1000;
 }
 
+/*
+        Content of 'srcs/agents/MinMaxAlphaBetaAgent.cpp'
+*/
+
+MinMaxAlphaBetaAgent::MinMaxAlphaBetaAgent(AbstractHeuristic *heuristic, int ms_constraint)
+{
+    this->_heuristic = heuristic;
+    this->_ms_constraint = ms_constraint;
+    this->_ms_turn_stop = ms_constraint * 0.95;
+    this->_depth_reached = 0;
+    this->_nodes_explored = 0;
+    this->_nodes_limit = std::numeric_limits<int>::max();
+    this->_nodes_budget = std::numeric_limits<int>::max();
+    this->_follow_pv = false;
+    this->_start_time = 0;
+}
+
+void MinMaxAlphaBetaAgent::get_qualities(Board *board, vector<Move> moves, vector<float> *qualities)
+{
+    this->_start_time = clock();
+
+    for (size_t i = 0; i < moves.size(); i++)
+        qualities->push_back(0);
+
+    // Root moves are searched best first, the order being kept from one iteration to the next
+    vector<size_t> order(moves.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    int   white_sign = board->is_white_turn() ? 1 : -1;
+    int   max_depth = 2;
+    float score = 0;
+    this->_nodes_explored = 0;
+    this->_nodes_limit = this->_nodes_budget;
+    this->_killer_moves.clear();
+    this->_pv_table.clear();
+    this->_principal_variation.clear();
+    while (!this->is_time_up())
+    {
+        prepare_tables(max_depth);
+
+        vector<Move> ordered_moves;
+        for (size_t i : order)
+            ordered_moves.push_back(moves[i]);
+
+        // Aspiration windows: a window around the previous score, widened each time it fails
+        float delta = MMAB_ASPIRATION_WINDOW;
+        bool  aspiration = max_depth > 2 && fabs(score) < 1;
+        float alpha = aspiration ? add_centipawns(score, -delta) : -1;
+        float beta = aspiration ? add_centipawns(score, delta) : 1;
+
+        vector<float> scores(moves.size(), -1);
+        float         iteration_score;
+        while (true)
+        {
+            iteration_score = root_search(board, &ordered_moves, max_depth, alpha, beta, &scores);
+
+            if (this->is_time_up())
+                break;
+
+            delta *= 4;
+            if (iteration_score <= alpha && alpha > -1)
+                alpha = delta < MMAB_ASPIRATION_FULL_WIDTH ? add_centipawns(score, -delta) : -1;
+            else if (iteration_score >= beta && beta < 1)
+                beta = delta < MMAB_ASPIRATION_FULL_WIDTH ? add_centipawns(score, delta) : 1;
+            else
+                break;
+        }
+
+        if (this->is_time_up())
+            break;
+
+        score = iteration_score;
+        this->_principal_variation = this->_pv_table[0];
+
+        // Moves other than the best only hold upper bounds, which are kept strictly below it
+        size_t best_k = max_element(scores.begin(), scores.end()) - scores.begin();
+        for (size_t k = 0; k < order.size(); k++)
+        {
+            float quality = k == best_k ? score : min(scores[k], nextafterf(score, -2));
+            qualities->at(order[k]) = white_sign * quality;
+        }
+
+        std::rotate(order.begin(), order.begin() + best_k, order.begin() + best_k + 1);
+
+        // Deeper iterations can't change a decided game
+        if (fabs(score) >= 1)
+            break;
+
+        max_depth++;
+    }
+
+    this->_depth_reached = max_depth;
+
+    float dtime = elapsed_time();
+    if (dtime >= _ms_constraint)
+        cerr << "MinMaxAlphaBetaAgent: TIMEOUT: dtime=" << dtime << "/" << this->_ms_constraint
+             << "ms" << endl;
+}
+
+vector<string> MinMaxAlphaBetaAgent::get_stats()
+{
+    vector<string> stats;
+
+    string pv;
+    for (Move &move : this->_principal_variation)
+        pv += (pv.empty() ? "" : ",") + move.to_uci();
+
+    stats.push_back("version=BbMmabPv-rc");
+    stats.push_back("depth=" + to_string(this->_depth_reached));
+    stats.push_back("states=" + to_string(this->_nodes_explored));
+    stats.push_back("pv=" + pv);
+    this->_heuristic->log_stats("BbMmabPv-rc", &stats);
+    return stats;
+}
+
+string MinMaxAlphaBetaAgent::get_name()
+{
+    return Board::get_name() + ".MinMaxAlphaBetaAgent[" + to_string(this->_ms_constraint) + "ms]." +
+           this->_heuristic->get_name();
+}
+
+float MinMaxAlphaBetaAgent::search(
+    Board *board, int max_depth, int nodes_limit, clock_t start_time
+)
+{
+    this->_start_time = start_time;
+    this->_nodes_explored = 0;
+    this->_nodes_limit = nodes_limit;
+    this->_killer_moves.clear();
+    this->_pv_table.clear();
+    this->_follow_pv = false;
+    prepare_tables(max_depth);
+
+    float quality = this->negamax(board, max_depth, 0, -1, 1);
+
+    // An interrupted search only holds a partial minimax value
+    if (this->is_time_up())
+        return this->_heuristic->evaluate(board);
+
+    return board->is_white_turn() ? quality : -quality;
+}
+
+float MinMaxAlphaBetaAgent::root_search(
+    Board *board, vector<Move> *moves, int max_depth, float alpha, float beta,
+    vector<float> *scores
+)
+{
+    this->_nodes_explored++;
+    this->_pv_table[0].clear();
+
+    float best_score = -1;
+    for (size_t i = 0; i < moves->size(); i++)
+    {
+        Board new_board = *board;
+        new_board.apply_move(moves->at(i));
+
+        this->_follow_pv =
+            !this->_principal_variation.empty() && moves->at(i) == &this->_principal_variation[0];
+        float score = i == 0 ? -this->negamax(&new_board, max_depth, 1, -beta, -alpha)
+                             : this->search_move(&new_board, max_depth, 1, alpha, beta, 0);
+
+        if (this->is_time_up())
+            break;
+
+        scores->at(i) = score;
+        best_score = max(best_score, score);
+
+        if (score > alpha)
+        {
+            alpha = score;
+            update_principal_variation(moves->at(i), 0);
+        }
+        if (alpha >= beta)
+            break;
+    }
+
+    return best_score;
+}
+
+float MinMaxAlphaBetaAgent::negamax(
+    Board *board, int max_depth, int depth, float alpha, float beta, bool null_move_allowed
+)
+{
+    this->_pv_table[depth].clear();
+
+    if (depth >= max_depth)
+        return this->quiescence(board, alpha, beta);
+
+    this->_nodes_explored++;
+
+    if (this->is_time_up() || board->get_game_state() != GAME_CONTINUE)
+        return this->evaluate(board);
+
+    int  remaining_depth = max_depth - depth;
+    bool in_check = board->get_check_state();
+    bool selective = depth > 0 && !in_check;
+
+    // Previous iteration's PV move is tried first, as long as the path follows that PV
+    Move *pv_move = this->_follow_pv && depth < (int)this->_principal_variation.size()
+                        ? &this->_principal_variation[depth]
+                        : nullptr;
+    this->_follow_pv = false;
+
+    float static_evaluation = 0;
+    if (selective && (MMAB_FUTILITY_PRUNING || MMAB_NULL_MOVE_PRUNING))
+        static_evaluation = this->evaluate(board);
+
+    // Razoring: far enough below the window near the leaves, only captures can bring it back
+    if (MMAB_FUTILITY_PRUNING && selective && remaining_depth <= 2 &&
+        add_centipawns(static_evaluation, MMAB_RAZORING_MARGIN * remaining_depth) <= alpha)
+    {
+        float score = this->quiescence(board, alpha, beta);
+        if (score <= alpha)
+            return score;
+    }
+
+    // Null move pruning: if passing still fails high, a real move would too
+    if (MMAB_NULL_MOVE_PRUNING && selective && null_move_allowed &&
+        remaining_depth >= MMAB_NULL_MOVE_MIN_DEPTH && static_evaluation >= beta &&
+        has_non_pawn_material(board))
+    {
+        Board null_board = *board;
+        null_board.apply_null_move();
+
+        float score = -this->negamax(
+            &null_board, max_depth - MMAB_NULL_MOVE_REDUCTION, depth + 1, -beta,
+            -nextafterf(beta, -2), false
+        );
+
+        if (!this->is_time_up() && score >= beta)
+            return beta;
+    }
+
+    // Futility pruning: at the frontier, quiet moves can't bring the evaluation back in the window
+    bool futile = MMAB_FUTILITY_PRUNING && selective && remaining_depth == 1 &&
+                  add_centipawns(static_evaluation, MMAB_FUTILITY_MARGIN) <= alpha;
+
+    MovePicker picker(board, pv_move, &this->_killer_moves[depth]);
+
+    float best_score = -1;
+    int   move_index = 0;
+    Move  move(EMPTY_CELL, 0UL, 0UL);
+    while (picker.next_move(&move))
+    {
+        Board new_board = *board;
+        new_board.apply_move(move);
+
+        bool late_quiet_move =
+            picker.get_stage() == QUIET_MOVES_STAGE && !new_board.get_check_state();
+        int index = move_index++;
+
+        if (futile && late_quiet_move && index > 0)
+            continue;
+
+        // Late move reductions: well ordered moves rarely improve alpha, they are first searched
+        // one ply shallower
+        int reduction = MMAB_LATE_MOVE_REDUCTIONS && late_quiet_move && !in_check &&
+                        index >= MMAB_LMR_MIN_MOVE_INDEX && remaining_depth >= MMAB_LMR_MIN_DEPTH;
+
+        this->_follow_pv = pv_move && index == 0 && move == pv_move;
+        float score;
+        if (index == 0)
+            score = -this->negamax(&new_board, max_depth, depth + 1, -beta, -alpha);
+        else
+            score = this->search_move(&new_board, max_depth, depth + 1, alpha, beta, reduction);
+
+        if (this->is_time_up())
+            break;
+
+        best_score = max(best_score, score);
+
+        if (score > alpha)
+        {
+            alpha = score;
+            update_principal_variation(move, depth);
+        }
+        if (alpha >= beta)
+        {
+            if (picker.is_quiet_move_stage())
+                store_killer_move(move, depth);
+            break;
+        }
+    }
+
+    return best_score;
+}
+
+float MinMaxAlphaBetaAgent::search_move(
+    Board *board, int max_depth, int depth, float alpha, float beta, int reduction
+)
+{
+    // Null window scout, then full window search of the moves failing high
+    float scout_beta = nextafterf(alpha, 2);
+    float score = -this->negamax(board, max_depth - reduction, depth, -scout_beta, -alpha);
+
+    if (score > alpha && reduction)
+        score = -this->negamax(board, max_depth, depth, -scout_beta, -alpha);
+    if (score > alpha && score < beta)
+        score = -this->negamax(board, max_depth, depth, -beta, -alpha);
+
+    return score;
+}
+
+float MinMaxAlphaBetaAgent::quiescence(Board *board, float alpha, float beta)
+{
+    /*
+        Leaves are only evaluated once quiet: captures are searched until none is left
+        that doesn't lose material, the side to move being free to stand on the evaluation.
+    */
+    this->_nodes_explored++;
+
+    float stand_pat = this->evaluate(board);
+    if (this->is_time_up() || board->get_game_state() != GAME_CONTINUE || stand_pat >= beta)
+        return stand_pat;
+
+    alpha = max(alpha, stand_pat);
+
+    float      best_score = stand_pat;
+    MovePicker picker(board, nullptr, nullptr, true);
+    Move       move(EMPTY_CELL, 0UL, 0UL);
+    while (picker.next_move(&move))
+    {
+        Board new_board = *board;
+        new_board.apply_move(move);
+
+        float score = -this->quiescence(&new_board, -beta, -alpha);
+
+        if (this->is_time_up())
+            break;
+
+        best_score = max(best_score, score);
+        alpha = max(alpha, score);
+        if (alpha >= beta)
+            break;
+    }
+
+    return best_score;
+}
+
+float MinMaxAlphaBetaAgent::evaluate(Board *board)
+{
+    float evaluation = this->_heuristic->evaluate(board);
+
+    return board->is_white_turn() ? evaluation : -evaluation;
+}
+
+bool MinMaxAlphaBetaAgent::has_non_pawn_material(Board *board)
+{
+    // Null moves are unsafe in pawn endings, where zugzwang is common
+    const uint64_t *pieces = board->bitboards[board->is_white_turn() ? WHITE : BLACK];
+
+    return pieces[KNIGHT] | pieces[BISHOP] | pieces[ROOK] | pieces[QUEEN];
+}
+
+float MinMaxAlphaBetaAgent::add_centipawns(float evaluation, float centipawns)
+{
+    /*
+        Evaluations are e / (1 + |e|) of a centipawn score e, so margins are added to e.
+        Decided games stay decided.
+    */
+    if (fabs(evaluation) >= 1)
+        return evaluation;
+
+    float score = evaluation / (1 - fabs(evaluation)) + centipawns;
+    return score / (1 + fabs(score));
+}
+
+void MinMaxAlphaBetaAgent::store_killer_move(Move move, int depth)
+{
+    vector<Move> &killers = this->_killer_moves[depth];
+
+    if (!killers.empty() && killers[0].src == move.src && killers[0].dst == move.dst)
+        return;
+
+    killers.insert(killers.begin(), move);
+    if (killers.size() > 2)
+        killers.pop_back();
+}
+
+void MinMaxAlphaBetaAgent::update_principal_variation(Move move, int depth)
+{
+    vector<Move> &line = this->_pv_table[depth];
+    vector<Move> &child_line = this->_pv_table[depth + 1];
+
+    line.clear();
+    line.push_back(move);
+    line.insert(line.end(), child_line.begin(), child_line.end());
+}
+
+void MinMaxAlphaBetaAgent::prepare_tables(int max_depth)
+{
+    // Pickers point into the killer moves, which must not be reallocated during the search
+    this->_killer_moves.resize(max_depth + 1);
+    this->_pv_table.resize(max_depth + 2);
+}
+
+bool MinMaxAlphaBetaAgent::is_time_up()
+{
+    return this->_nodes_explored >= this->_nodes_limit ||
+           this->elapsed_time() >= this->_ms_turn_stop;
+}
+
+float MinMaxAlphaBetaAgent::elapsed_time()
+{
+    return (float)(clock() - this->_start_time) / CLOCKS_PER_SEC * 1000;
+}
+
+/*
+        Content of 'srcs/agents/MctsAlphaBetaAgent.cpp'
+*/
+
+MctsAlphaBetaAgent::MctsAlphaBetaAgent(AbstractHeuristic *heuristic, int ms_constraint)
+    : MctsAgent(heuristic, ms_constraint)
+{
+    this->_alpha_beta = new MinMaxAlphaBetaAgent(heuristic, ms_constraint);
+
+    this->_leaf_depth = 1;
+    this->_ms_per_leaf = this->_ms_turn_stop / MCTS_AB_MIN_ITERATIONS;
+    this->_nodes_per_ms = 0;
+
+    this->_leaf_searches = 0;
+    this->_leaf_nodes = 0;
+    this->_leaf_children = 0;
+    this->_leaf_clock = 0;
+}
+
+void MctsAlphaBetaAgent::get_qualities(Board *board, vector<Move> moves, vector<float> *qualities)
+{
+    this->_leaf_searches = 0;
+    this->_leaf_nodes = 0;
+    this->_leaf_children = 0;
+    this->_leaf_clock = 0;
+
+    MctsAgent::get_qualities(board, moves, qualities);
+
+    adapt_leaf_depth();
+}
+
+vector<string> MctsAlphaBetaAgent::get_stats()
+{
+    vector<string> stats;
+
+    stats.push_back("version=BbMctsPv-rc");
+    stats.push_back("depth=" + to_string(this->_depth_reached));
+    stats.push_back("states=" + to_string(this->_nodes_explored));
+    stats.push_back("winrate=" + to_string(this->_winrate));
+    stats.push_back("abdepth=" + to_string(this->_leaf_depth));
+    this->_heuristic->log_stats("BbMctsPv-rc", &stats);
+
+    return stats;
+}
+
+string MctsAlphaBetaAgent::get_name()
+{
+    return Board::get_name() + ".MctsAlphaBetaAgent[" + to_string(this->_ms_constraint) + "ms]." +
+           this->_heuristic->get_name();
+}
+
+float MctsAlphaBetaAgent::simulation(Node *node)
+{
+    this->_leaf_searches++;
+    this->_leaf_children += node->children_nodes.size();
+
+    // Past twice the measured budget, the leaf falls back on the static evaluation
+    int nodes_limit = this->_nodes_per_ms > 0
+                          ? max(1, (int)(2 * this->_nodes_per_ms * this->_ms_per_leaf))
+                          : std::numeric_limits<int>::max();
+
+    clock_t leaf_start = clock();
+    float   evaluation = this->_alpha_beta->search(
+        node->resulting_board, this->_leaf_depth, nodes_limit, this->_start_time
+    );
+    this->_leaf_clock += clock() - leaf_start;
+    this->_leaf_nodes += this->_alpha_beta->get_nodes_explored();
+
+    int player = node->resulting_board->is_white_turn() ? -1 : 1;
+    return (1 + player * evaluation) / 2;
+}
+
+void MctsAlphaBetaAgent::adapt_leaf_depth()
+{
+    /*
+        Deepen the leaf searches while the next depth is expected to fit the
+        per-leaf time budget, and come back up when the current one doesn't.
+    */
+    if (this->_leaf_searches == 0)
+        return;
+
+    float leaf_ms = (float)this->_leaf_clock / CLOCKS_PER_SEC * 1000;
+    if (leaf_ms > 0)
+        this->_nodes_per_ms = this->_leaf_nodes / leaf_ms;
+
+    if (this->_nodes_per_ms == 0)
+        return;
+
+    float nodes_budget = this->_nodes_per_ms * this->_ms_per_leaf;
+    float average_nodes = (float)this->_leaf_nodes / this->_leaf_searches;
+    float average_children = max(1.0f, (float)this->_leaf_children / this->_leaf_searches);
+
+    // Depth 1 is kept even over budget, the nodes limit of the searches bounds their cost
+    if (average_nodes > nodes_budget)
+    {
+        if (this->_leaf_depth > 1)
+            this->_leaf_depth--;
+    }
+    else if (average_nodes * average_children <= nodes_budget)
+        this->_leaf_depth++;
+}
+
 /*
         Content of 'srcs/heuristics/PiecesHeuristic.cpp'
 */
 
 #include <algorithm>
 
-PiecesHeuristic::PiecesHeuristic()
+constexpr std::array<float, EVALUATION_WINRATE_MAP_SIZE>
+PiecesHeuristic::_create_evaluation_winrate_map()
 {
+    std::array<float, EVALUATION_WINRATE_MAP_SIZE> winrate_map{};
+
     for (int i = 0, eval = -EVALUATION_WINRATE_MAP_SIZE / 2; i < EVALUATION_WINRATE_MAP_SIZE;
          i++, eval++)
     {
         if (eval > 0)
-            _evaluation_winrate_map[i] = 1 - 1.0 / (1 + eval);
+            winrate_map[i] = 1 - 1.0 / (1 + eval);
         else
-            _evaluation_winrate_map[i] = -1 - 1.0 / (-1 + eval);
+            winrate_map[i] = -1 - 1.0 / (-1 + eval);
     }
+
+    return winrate_map;
+}
+
+constexpr std::array<float, EVALUATION_WINRATE_MAP_SIZE> PiecesHeuristic::_evaluation_winrate_map =
+    PiecesHeuristic::_create_evaluation_winrate_map();
+
+PiecesHeuristic::PiecesHeuristic()
+    : _evaluation_cache(EVALUATION_CACHE_SIZE, EvaluationCacheEntry{0, 0}),
+      _pawn_cache(PAWN_CACHE_SIZE, PawnCacheEntry{0, 0})
+{
+    this->_evaluation_cache_hits = 0;
+    this->_evaluation_cache_misses = 0;
+    this->_pawn_cache_hits = 0;
+    this->_pawn_cache_misses = 0;
 }
 
 float PiecesHeuristic::evaluate(Board *board)
 {
+    // Game ends depend on the history, which isn't hashed: they are never cached
     float state = board->get_game_state();
     if (state != GAME_CONTINUE)
     {
@@ -3068,6 +5118,34 @@ float PiecesHeuristic::evaluate(Board *board)
             return 1;
     }
 
+    uint64_t              hash = board->get_hash();
+    EvaluationCacheEntry &entry = _evaluation_cache[hash & (EVALUATION_CACHE_SIZE - 1)];
+    if (entry.hash == hash)
+    {
+        _evaluation_cache_hits++;
+        return entry.evaluation;
+    }
+    _evaluation_cache_misses++;
+
+    entry.hash = hash;
+    entry.evaluation = _compute_evaluation(board);
+    return entry.evaluation;
+}
+
+vector<string> PiecesHeuristic::get_stats()
+{
+    vector<string> stats;
+
+    stats.push_back("evalhits=" + to_string(this->_evaluation_cache_hits));
+    stats.push_back("evalmisses=" + to_string(this->_evaluation_cache_misses));
+    stats.push_back("pawnhits=" + to_string(this->_pawn_cache_hits));
+    stats.push_back("pawnmisses=" + to_string(this->_pawn_cache_misses));
+
+    return stats;
+}
+
+float PiecesHeuristic::_compute_evaluation(Board *board)
+{
     int white_material;
     int black_material;
     int material_evaluation = _material_evaluation(board, &white_material, &black_material);
@@ -3083,19 +5161,16 @@ float PiecesHeuristic::evaluate(Board *board)
     int pp_evaluation =
         _piece_positions_evaluation(board, white_eg_coefficient, black_eg_coefficient);
 
-    int white_control_on_empty_cell_count =
-        _count_bits(board->attacked_by_white_mask & board->empty_cells_mask);
-    int white_control_on_enemy_cell_count =
-        _count_bits(board->attacked_by_white_mask & board->black_pieces_mask);
-    int white_control_on_ally_cell_count =
-        _count_bits(board->attacked_by_white_mask & board->white_pieces_mask);
+    uint64_t white_attacks = board->get_attacked_cells_mask(WHITE);
+    uint64_t black_attacks = board->get_attacked_cells_mask(BLACK);
 
-    int black_control_on_empty_cell_count =
-        _count_bits(board->attacked_by_black_mask & board->empty_cells_mask);
-    int black_control_on_enemy_cell_count =
-        _count_bits(board->attacked_by_black_mask & board->white_pieces_mask);
-    int black_control_on_ally_cell_count =
-        _count_bits(board->attacked_by_black_mask & board->black_pieces_mask);
+    int white_control_on_empty_cell_count = _count_bits(white_attacks & board->empty_cells_mask);
+    int white_control_on_enemy_cell_count = _count_bits(white_attacks & board->black_pieces_mask());
+    int white_control_on_ally_cell_count = _count_bits(white_attacks & board->white_pieces_mask());
+
+    int black_control_on_empty_cell_count = _count_bits(black_attacks & board->empty_cells_mask);
+    int black_control_on_enemy_cell_count = _count_bits(black_attacks & board->white_pieces_mask());
+    int black_control_on_ally_cell_count = _count_bits(black_attacks & board->black_pieces_mask());
 
     int control_evaluation = (white_control_on_empty_cell_count - black_control_on_empty_cell_count
                              ) * control_value_for_empty_cell +
@@ -3104,7 +5179,10 @@ float PiecesHeuristic::evaluate(Board *board)
                              (white_control_on_ally_cell_count - black_control_on_ally_cell_count) *
                                  control_value_for_ally_cell;
 
-    int evaluation = material_evaluation + pp_evaluation + control_evaluation;
+    int pawn_structure_evaluation = _pawn_structure_evaluation(board);
+
+    int evaluation =
+        material_evaluation + pp_evaluation + control_evaluation + pawn_structure_evaluation;
 
     return _evaluation_winrate_map[evaluation + EVALUATION_WINRATE_MAP_SIZE / 2];
 }
@@ -3116,16 +5194,16 @@ string PiecesHeuristic::get_name()
 
 int PiecesHeuristic::_material_evaluation(Board *board, int *white_material, int *black_material)
 {
-    int white_pawn_count = _count_bits(board->white_pawns);
-    int white_knight_count = _count_bits(board->white_knights);
-    int white_bishop_count = _count_bits(board->white_bishops);
-    int white_rook_count = _count_bits(board->white_rooks);
-    int white_queen_count = _count_bits(board->white_queens);
-    int black_pawn_count = _count_bits(board->black_pawns);
-    int black_knight_count = _count_bits(board->black_knights);
-    int black_bishop_count = _count_bits(board->black_bishops);
-    int black_rook_count = _count_bits(board->black_rooks);
-    int black_queen_count = _count_bits(board->black_queens);
+    int white_pawn_count = _count_bits(board->white_pawns());
+    int white_knight_count = _count_bits(board->white_knights());
+    int white_bishop_count = _count_bits(board->white_bishops());
+    int white_rook_count = _count_bits(board->white_rooks());
+    int white_queen_count = _count_bits(board->white_queens());
+    int black_pawn_count = _count_bits(board->black_pawns());
+    int black_knight_count = _count_bits(board->black_knights());
+    int black_bishop_count = _count_bits(board->black_bishops());
+    int black_rook_count = _count_bits(board->black_rooks());
+    int black_queen_count = _count_bits(board->black_queens());
 
     *white_material = white_pawn_count * PAWN_VALUE + white_knight_count * KNIGHT_VALUE +
                       white_bishop_count * BISHOP_VALUE + white_rook_count * ROOK_VALUE +
@@ -3145,34 +5223,87 @@ int PiecesHeuristic::_piece_positions_evaluation(
 
     pp_eval += _lookup_bonuses_for_all_pieces(
         white_pawn_sg_bonus_table, white_pawn_eg_bonus_table, white_eg_coefficient,
-        board->white_pawns
+        board->white_pawns()
     );
-    pp_eval += _lookup_bonuses_for_all_pieces(white_knight_bonus_table, board->white_knights);
-    pp_eval += _lookup_bonuses_for_all_pieces(white_bishop_bonus_table, board->white_bishops);
-    pp_eval += _lookup_bonuses_for_all_pieces(white_rook_bonus_table, board->white_rooks);
-    pp_eval += _lookup_bonuses_for_all_pieces(white_queen_bonus_table, board->white_queens);
+    pp_eval += _lookup_bonuses_for_all_pieces(white_knight_bonus_table, board->white_knights());
+    pp_eval += _lookup_bonuses_for_all_pieces(white_bishop_bonus_table, board->white_bishops());
+    pp_eval += _lookup_bonuses_for_all_pieces(white_rook_bonus_table, board->white_rooks());
+    pp_eval += _lookup_bonuses_for_all_pieces(white_queen_bonus_table, board->white_queens());
     pp_eval += _lookup_bonuses_for_all_pieces(
         white_king_sg_bonus_table, white_king_eg_bonus_table, white_eg_coefficient,
-        board->white_king
+        board->white_king()
     );
 
     pp_eval -= _lookup_bonuses_for_all_pieces(
         black_pawn_sg_bonus_table, black_pawn_eg_bonus_table, black_eg_coefficient,
-        board->black_pawns
+        board->black_pawns()
     );
-    pp_eval -= _lookup_bonuses_for_all_pieces(black_knight_bonus_table, board->black_knights);
-    pp_eval -= _lookup_bonuses_for_all_pieces(black_bishop_bonus_table, board->black_bishops);
-    pp_eval -= _lookup_bonuses_for_all_pieces(black_rook_bonus_table, board->black_rooks);
-    pp_eval -= _lookup_bonuses_for_all_pieces(black_queen_bonus_table, board->black_queens);
+    pp_eval -= _lookup_bonuses_for_all_pieces(black_knight_bonus_table, board->black_knights());
+    pp_eval -= _lookup_bonuses_for_all_pieces(black_bishop_bonus_table, board->black_bishops());
+    pp_eval -= _lookup_bonuses_for_all_pieces(black_rook_bonus_table, board->black_rooks());
+    pp_eval -= _lookup_bonuses_for_all_pieces(black_queen_bonus_table, board->black_queens());
     pp_eval -= _lookup_bonuses_for_all_pieces(
         black_king_sg_bonus_table, black_king_eg_bonus_table, black_eg_coefficient,
-        board->black_king
+        board->black_king()
     );
 
     return pp_eval;
 }
 
-int PiecesHeuristic::_lookup_bonuses_for_all_pieces(int *bonus_table, uint64_t bitboard)
+int PiecesHeuristic::_pawn_structure_evaluation(Board *board)
+{
+    uint64_t        hash = board->get_pawns_hash();
+    PawnCacheEntry &entry = _pawn_cache[hash & (PAWN_CACHE_SIZE - 1)];
+    if (entry.hash == hash)
+    {
+        _pawn_cache_hits++;
+        return entry.evaluation;
+    }
+    _pawn_cache_misses++;
+
+    entry.hash = hash;
+    entry.evaluation =
+        _pawn_structure_evaluation(board->white_pawns(), board->black_pawns(), WHITE) -
+        _pawn_structure_evaluation(board->black_pawns(), board->white_pawns(), BLACK);
+    return entry.evaluation;
+}
+
+int PiecesHeuristic::_pawn_structure_evaluation(uint64_t pawns, uint64_t enemy_pawns, int color)
+{
+    const uint64_t file_a = 0x0101010101010101UL;
+
+    int      evaluation = 0;
+    uint64_t remaining_pawns = pawns;
+    while (remaining_pawns)
+    {
+        int lkt_i = _count_trailing_zeros(remaining_pawns);
+        int x = lkt_i % 8;
+        int y = lkt_i / 8;
+
+        uint64_t file = file_a << x;
+        uint64_t adjacent_files =
+            ((file & BITMASK_NOT_FILE_H) << 1) | ((file & BITMASK_NOT_FILE_A) >> 1);
+
+        // White pawns go up the board, to lower cells indexes. The black mask is written so the
+        // shift can't overflow on the last row
+        uint64_t ahead = color == WHITE ? (1UL << (y * 8)) - 1 : ~((2UL << (y * 8 + 7)) - 1);
+        int      rank = color == WHITE ? 7 - y : y;
+
+        // A file with n pawns is penalized n - 1 times, once per pawn with another one ahead
+        if (pawns & file & ahead)
+            evaluation -= doubled_pawn_penalty;
+        if (!(pawns & adjacent_files))
+            evaluation -= isolated_pawn_penalty;
+        if (!(enemy_pawns & (file | adjacent_files) & ahead))
+            evaluation += passed_pawn_bonus_table[rank];
+
+        remaining_pawns &= remaining_pawns - 1;
+    }
+
+    return evaluation;
+}
+
+int PiecesHeuristic::_lookup_bonuses_for_all_pieces(const int *bonus_table, uint64_t bitboard)
 {
     int bonuses = 0;
 
@@ -3189,7 +5320,7 @@ int PiecesHeuristic::_lookup_bonuses_for_all_pieces(int *bonus_table, uint64_t b
 }
 
 int PiecesHeuristic::_lookup_bonuses_for_all_pieces(
-    int *sg_bonus_table, int *eg_bonus_table, float eg_coef, uint64_t bitboard
+    const int *sg_bonus_table, const int *eg_bonus_table, float eg_coef, uint64_t bitboard
 )
 {
     int   bonuses = 0;
@@ -3208,6 +5339,42 @@ int PiecesHeuristic::_lookup_bonuses_for_all_pieces(
     return bonuses;
 }
 
+/*
+        Content of 'srcs/heuristics/NnueHeuristic.cpp'
+*/
+
+#if USE_NNUE == 1
+
+float NnueHeuristic::evaluate(Board *board)
+{
+    float state = board->get_game_state();
+    if (state != GAME_CONTINUE)
+    {
+        if (state == BLACK_WIN)
+            return -1;
+        else if (state == DRAW)
+            return 0;
+        else
+            return 1;
+    }
+
+    int ally = board->is_white_turn() ? WHITE : BLACK;
+    int evaluation =
+        Nnue::evaluate(board->nnue_accumulators[ally], board->nnue_accumulators[!ally]);
+    if (ally == BLACK)
+        evaluation = -evaluation;
+
+    // Same scale as PiecesHeuristic: e / (1 + |e|) of the evaluation e in centipawns
+    return evaluation / (1.0f + abs(evaluation));
+}
+
+string NnueHeuristic::get_name()
+{
+    return "NnueHeuristic";
+}
+
+#endif
+
 /*
         Content of 'srcs/players/BotPlayer.cpp'
 */
@@ -3262,15 +5429,222 @@ float BotPlayer::min_float(float a, float b)
     return min(a, b);
 }
 
+/*
+        Content of 'srcs/selfplay/SelfPlayGenerator.cpp'
+*/
+
+#if SELFPLAY == 1
+
+SelfPlayGenerator::SelfPlayGenerator(
+    string output_path, int threads_count, int nodes_per_move, int random_plies, unsigned int seed
+)
+{
+    this->_output_path = output_path;
+    this->_output = NULL;
+    this->_threads_count = threads_count;
+    this->_nodes_per_move = nodes_per_move;
+    this->_random_plies = random_plies;
+    this->_seed = seed;
+}
+
+bool SelfPlayGenerator::run(int games_count)
+{
+    this->_output = new RecordFileWriter<SelfPlayRecord>(this->_output_path);
+    if (!this->_output->is_open())
+    {
+        delete this->_output;
+        return false;
+    }
+
+    this->_games_started = 0;
+    this->_games_played = 0;
+    this->_positions_written = 0;
+    this->_start_time = std::chrono::steady_clock::now();
+
+    vector<std::thread> workers;
+    for (int i = 0; i < this->_threads_count; i++)
+        workers.emplace_back(&SelfPlayGenerator::_worker, this, i, games_count);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    delete this->_output;
+
+    cerr << "SelfPlayGenerator: " << this->_games_played << " games, "
+         << this->_positions_written << " positions written to " << this->_output_path << endl;
+    return true;
+}
+
+void SelfPlayGenerator::_worker(int worker_index, int games_count)
+{
+    // Each thread owns its agent, whose heuristic caches aren't shared
+    std::mt19937         rng(this->_seed + worker_index);
+    MinMaxAlphaBetaAgent agent(new PiecesHeuristic(), SELFPLAY_MS_CONSTRAINT);
+    agent.set_nodes_budget(this->_nodes_per_move);
+
+    while (this->_games_started++ < games_count)
+        _play_game(&rng, &agent);
+}
+
+void SelfPlayGenerator::_play_game(std::mt19937 *rng, MinMaxAlphaBetaAgent *agent)
+{
+    Board board(_create_random_chess960_fen(rng), true, true);
+
+    for (int ply = 0; ply < this->_random_plies && board.get_game_state() == GAME_CONTINUE; ply++)
+    {
+        vector<Move> moves = board.get_available_moves();
+        board.apply_move(moves[(*rng)() % moves.size()]);
+    }
+
+    vector<SelfPlayRecord> records;
+    while (board.get_game_state() == GAME_CONTINUE)
+    {
+        vector<Move>  moves = board.get_available_moves();
+        vector<float> qualities;
+        agent->get_qualities(&board, moves, &qualities);
+
+        auto   best = board.is_white_turn() ? max_element(qualities.begin(), qualities.end())
+                                            : min_element(qualities.begin(), qualities.end());
+        size_t best_index = best - qualities.begin();
+
+        // Positions in check are rarely quiet enough for evaluation tuning
+        if (!board.get_check_state())
+            records.push_back(_create_record(&board, qualities[best_index]));
+
+        board.apply_move(moves[best_index]);
+    }
+
+    float state = board.get_game_state();
+    for (SelfPlayRecord &record : records)
+        record.result = state == WHITE_WIN ? 1 : state == BLACK_WIN ? -1 : 0;
+
+    _write_records(records);
+}
+
+void SelfPlayGenerator::_write_records(vector<SelfPlayRecord> &records)
+{
+    std::lock_guard<std::mutex> lock(this->_output_mutex);
+
+    // Flushed game by game, so that a killed run keeps all its finished games
+    if (this->_output->write(records.data(), records.size()) && this->_output->flush())
+        this->_positions_written += records.size();
+
+    int games_played = ++this->_games_played;
+    if (games_played % 100 == 0)
+    {
+        float minutes = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+                                                     this->_start_time)
+                            .count() /
+                        60;
+        cerr << "SelfPlayGenerator: " << games_played << " games, " << this->_positions_written
+             << " positions, " << (int)(games_played / minutes) << " games/min" << endl;
+    }
+}
+
+string SelfPlayGenerator::_create_random_chess960_fen(std::mt19937 *rng)
+{
+    /*
+        Bishops go on cells of opposite colors, then the queen and knights on random free cells.
+        The three cells left are, in order, a rook, the king and the other rook.
+    */
+    string back_rank(8, ' ');
+    back_rank[2 * ((*rng)() % 4)] = 'b';
+    back_rank[2 * ((*rng)() % 4) + 1] = 'b';
+
+    for (char piece : {'q', 'n', 'n'})
+    {
+        vector<int> free_cells;
+        for (int x = 0; x < 8; x++)
+            if (back_rank[x] == ' ')
+                free_cells.push_back(x);
+        back_rank[free_cells[(*rng)() % free_cells.size()]] = piece;
+    }
+
+    string castling;
+    const char *remaining_pieces = "rkr";
+    for (int x = 0; x < 8; x++)
+    {
+        if (back_rank[x] != ' ')
+            continue;
+        back_rank[x] = *remaining_pieces++;
+        if (back_rank[x] == 'r')
+            castling += column_index_to_name(x);
+    }
+
+    string white_back_rank = back_rank;
+    string white_castling = castling;
+    transform(white_back_rank.begin(), white_back_rank.end(), white_back_rank.begin(), ::toupper);
+    transform(white_castling.begin(), white_castling.end(), white_castling.begin(), ::toupper);
+
+    return back_rank + "/pppppppp/8/8/8/8/PPPPPPPP/" + white_back_rank + " w " + white_castling +
+           castling + " - 0 1";
+}
+
+SelfPlayRecord SelfPlayGenerator::_create_record(Board *board, float score)
+{
+    SelfPlayRecord record = {};
+
+    board->pack(&record.board);
+
+    // Scores are e / (1 + |e|) of a centipawn score e
+    if (fabs(score) >= 1)
+        record.score = score > 0 ? SELFPLAY_MATE_SCORE : -SELFPLAY_MATE_SCORE;
+    else
+        record.score = max(
+            min(score / (1 - fabs(score)), (float)SELFPLAY_MATE_SCORE - 1),
+            (float)-SELFPLAY_MATE_SCORE + 1
+        );
+
+    return record;
+}
+
+#endif
+
+/*
+        Content of 'mains/selfplay.cpp'
+*/
+
+#if SELFPLAY == 1
+
+int main(int argc, char **argv)
+{
+    /*
+        g++ -std=c++17 -O2 -pthread -DSELFPLAY=1 BbMctsPv-rc.cpp -o selfplay
+        ./selfplay OUTPUT [GAMES] [THREADS] [NODES_PER_MOVE] [RANDOM_PLIES] [SEED]
+    */
+    if (argc < 2)
+    {
+        cerr << "usage: " << argv[0]
+             << " OUTPUT [GAMES] [THREADS] [NODES_PER_MOVE] [RANDOM_PLIES] [SEED]" << endl;
+        return 1;
+    }
+
+    int          games_count = argc > 2 ? stoi(argv[2]) : 1000;
+    int          threads_count = argc > 3 ? stoi(argv[3]) : std::thread::hardware_concurrency();
+    int          nodes_per_move = argc > 4 ? stoi(argv[4]) : 5000;
+    int          random_plies = argc > 5 ? stoi(argv[5]) : 4;
+    unsigned int seed = argc > 6 ? stoul(argv[6]) : std::random_device()();
+
+    SelfPlayGenerator generator(
+        argv[1], max(threads_count, 1), nodes_per_move, random_plies, seed
+    );
+    return generator.run(games_count) ? 0 : 1;
+}
+
+#endif
+
 /*
         Content of 'mains/main.cpp'
 */
 
 using namespace std;
 
+#if SELFPLAY == 0
+
 int main()
 {
     GameEngine *game_engine =
-        new GameEngine(new BotPlayer(new MctsAgent(new PiecesHeuristic(), 50)));
+        new GameEngine(new BotPlayer(new MctsAlphaBetaAgent(new PiecesHeuristic(), 50)));
     game_engine->infinite_game_loop();
 }
+
+#endif
@@ -5,9 +5,21 @@ if __name__ == '__main__':
 
     f, log_file = tempfile.mkstemp(prefix='log_')
     os.close(f)
+    players = sys.argv[1:]
     seed = random.randrange(0, 2**31)
-    n_players = len(sys.argv) - 1
-    cmd = 'java -jar ../codingame-chess/target/chess-1.0-SNAPSHOT.jar' + ''.join([f' -p{i} "{sys.argv[i]}"' for i in range(1, n_players+1)]) + f' -d seed={seed} -l "{log_file}"'
+    cores = None
+    while players and players[0].startswith('--'):
+        option, value = players.pop(0)[2:].split('=')
+        if option == 'seed': # psyleague's %SEED%, shared by both games of a pair
+            seed = int(value)
+        if option == 'cores': # psyleague's %CORES%
+            cores = value.split(',') if value else None # empty when psyleague doesn't pin games
+    referee = 'java -jar'
+    if cores: # the first core is left for the referee & every bot gets its own core (linux only)
+        referee = f'taskset -c {cores[0]} {referee}'
+        players = [f'taskset -c {cores[(i+1) % len(cores)]} {player}' for i, player in enumerate(players)]
+    n_players = len(players)
+    cmd = referee + ' ../codingame-chess/target/chess-1.0-SNAPSHOT.jar' + ''.join([f' -p{i+1} "{players[i]}"' for i in range(n_players)]) + f' -d seed={seed} -l "{log_file}"'
     task = subprocess.run(cmd, shell=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
     with open(log_file, 'r') as f:
         json_log = json.load(f)
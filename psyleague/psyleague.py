@@ -33,6 +33,7 @@
 __version__ = '0.4.1'
 
 import re
+import math
 import signal
 import time
 import shutil
@@ -43,10 +44,14 @@ import sys
 import os.path
 import subprocess
 import queue
+import concurrent.futures
+import socket
 import traceback
+import zlib
 import csv
 import numpy as np
 from datetime import datetime
+import threading
 from threading import Thread
 from typing import List, Dict, Tuple, Any, Union
 
@@ -59,17 +64,28 @@ import choix
 import toml
 from tqdm import tqdm
 
+try:
+    from psyleague import _rating # optional native rating kernel (see rating.cpp)
+except ImportError:
+    _rating = None
+
 CONFIG_FILE = 'psyleague.cfg'
+MSG_CHECK_INTERVAL = 1.0 # fallback check of the msg file in case a wakeup datagram was lost
+RATING_TOLERANCE = 1e-6 # native rating kernel is only equivalent to the rating libraries up to floating point errors
 
 args = None
 cfg = None
+bootstrap_state = None # state of a bootstrap worker process (see bootstrap_ranking)
 
 games_queue = queue.Queue()
-results_queue = queue.Queue()
+# single wakeup point of the server: ('game', Game) from workers & ('msg', None) from the control channel
+events_queue = queue.Queue()
 
 def try_str_to_numeric(x):
     if x is None:
         return None
+    if isinstance(x, (int, float)):
+        return x
     try: 
         return int(x)
     except ValueError:
@@ -156,6 +172,92 @@ class Game:
             
     def __repr__(self):
         return json.dumps(self.__dict__)
+
+class GameStore:
+    # Columnar version of the games file. test_data & player_data are stored as one column per variable:
+    # float64 with NaN for missing values, or str with '' for missing values when the variable isn't numeric.
+    # Player data columns have shape (games, n_players). bot_games[bot_offsets[i]:bot_offsets[i+1]] are the
+    # (sorted) indices of all games played by the bot with id i.
+    def __init__(self, names=None, players=None, ranks=None, errors=None, test_data=None, player_data=None, offset=0, checksum=0):
+        n_players = cfg['n_players']
+        self.names = names or []
+        self.ids = {name: i for i, name in enumerate(self.names)}
+        self.players = players if players is not None else np.zeros((0, n_players), dtype=np.int32)
+        self.ranks = ranks if ranks is not None else np.zeros((0, n_players), dtype=np.int32)
+        self.errors = errors if errors is not None else np.zeros((0, n_players), dtype=np.int32)
+        self.test_data = test_data or {}
+        self.player_data = player_data or {}
+        self.offset = offset # number of bytes of the games file that are already included
+        self.checksum = checksum # crc32 of the last line included, used for detecting rewrites of the games file
+        self._build_index()
+
+    def __len__(self) -> int:
+        return len(self.players)
+
+    def _build_index(self) -> None:
+        flat = self.players.ravel()
+        order = np.argsort(flat, kind='stable')
+        self.bot_games = (order // max(1, self.players.shape[1])).astype(np.int32)
+        self.bot_offsets = np.concatenate([[0], np.cumsum(np.bincount(flat, minlength=len(self.names)))]).astype(np.int64)
+
+    def bot_id(self, name: str) -> int:
+        return self.ids.get(name)
+
+    def games_of(self, name: str) -> np.ndarray:
+        i = self.bot_id(name)
+        if i is None:
+            return np.zeros(0, dtype=np.int32)
+        return self.bot_games[self.bot_offsets[i]:self.bot_offsets[i+1]]
+
+    @staticmethod
+    def _column(values: List[Any], shape: Tuple[int, ...]) -> np.ndarray:
+        if all(v is None or (isinstance(v, (int, float)) and not isinstance(v, bool)) for v in values):
+            return np.array([np.nan if v is None else v for v in values], dtype=np.float64).reshape(shape)
+        return np.array(['' if v is None else str(v) for v in values], dtype=str).reshape(shape)
+
+    @staticmethod
+    def _merge_columns(a: np.ndarray, b: np.ndarray) -> np.ndarray:
+        if a.dtype.kind != b.dtype.kind:
+            def to_str(c):
+                if c.dtype.kind == 'U':
+                    return c
+                return np.array(['' if np.isnan(x) else str(int(x)) if x.is_integer() else str(x) for x in c.ravel()], dtype=str).reshape(c.shape)
+            a, b = to_str(a), to_str(b)
+        return np.concatenate([a, b])
+
+    def append(self, games: List[Game]) -> None:
+        if not games:
+            return
+        for game in games:
+            for player in game.players:
+                if player not in self.ids:
+                    self.ids[player] = len(self.names)
+                    self.names.append(player)
+        n_players = cfg['n_players']
+        self.players = np.concatenate([self.players, np.array([[self.ids[p] for p in g.players] for g in games], dtype=np.int32)])
+        self.ranks = np.concatenate([self.ranks, np.array([g.ranks for g in games], dtype=np.int32)])
+        self.errors = np.concatenate([self.errors, np.array([g.errors for g in games], dtype=np.int32)])
+
+        n_old = len(self.players) - len(games)
+        for var in set(self.test_data) | {var for g in games for var in g.test_data}:
+            old = self.test_data.get(var, np.full(n_old, np.nan))
+            new = GameStore._column([g.test_data.get(var) for g in games], (len(games),))
+            self.test_data[var] = GameStore._merge_columns(old, new)
+        for var in set(self.player_data) | {var for g in games for d in g.player_data for var in d}:
+            old = self.player_data.get(var, np.full((n_old, n_players), np.nan))
+            new = GameStore._column([d.get(var) for g in games for d in g.player_data], (len(games), n_players))
+            self.player_data[var] = GameStore._merge_columns(old, new)
+        self._build_index()
+
+    def select(self, indices: np.ndarray) -> 'GameStore':
+        return GameStore(list(self.names), self.players[indices], self.ranks[indices], self.errors[indices],
+                         {var: c[indices] for var, c in self.test_data.items()}, {var: c[indices] for var, c in self.player_data.items()})
+
+    def to_games(self, indices: np.ndarray = None) -> List[Game]:
+        # lightweight games used for rating calculations, they don't contain test_data & player_data
+        indices = np.arange(len(self)) if indices is None else indices
+        return [Game([self.names[p] for p in players], ranks, errors) for players, ranks, errors in
+                zip(self.players[indices].tolist(), self.ranks[indices].tolist(), self.errors[indices].tolist())]
         
 #endregion    
 
@@ -185,6 +287,32 @@ def log(*args) -> None:
 def send_msg(msg: str) -> None:
     with portalocker.Lock(cfg['file_msg'], 'a', **lock_args) as f:
         f.write(msg + '\n')
+    wake_server()
+
+def wake_server() -> None:
+    # msg file is the source of truth, the datagram only wakes up the server immediately
+    try:
+        with open(cfg['file_port'], 'r') as f:
+            port = int(f.read().strip())
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+            sock.sendto(b'MSG', ('127.0.0.1', port))
+    except (OSError, ValueError):
+        pass
+
+def open_control_channel() -> socket.socket:
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('127.0.0.1', 0))
+    sock.settimeout(MSG_CHECK_INTERVAL)
+    with open(cfg['file_port'], 'w') as f:
+        f.write(str(sock.getsockname()[1]))
+    return sock
+
+def close_control_channel(sock: socket.socket) -> None:
+    sock.close()
+    try:
+        os.remove(cfg['file_port'])
+    except OSError:
+        pass
     
 def receive_msgs() -> List[str]:
     if not os.path.exists(cfg['file_msg']):
@@ -194,40 +322,238 @@ def receive_msgs() -> List[str]:
         f.truncate(0)
         return [s.strip() for s in msgs]
         
-def add_game(game: Game) -> None:
+def add_games(games: List[Game]) -> None:
+    # single write, so that a batch of games is committed at once
     with portalocker.Lock(cfg['file_games'], 'a', **lock_args) as f:
-        f.write(str(game) + '\n')
+        f.write(''.join(str(g) + '\n' for g in games))
+
+def count_games() -> int:
+    if not os.path.exists(cfg['file_games']):
+        return 0
+    with portalocker.Lock(cfg['file_games'], 'r', **lock_args) as f:
+        return sum(1 for _ in f)
+
+def repair_games() -> None:
+    # drops a partially written last line (crash in the middle of add_games)
+    if not os.path.exists(cfg['file_games']):
+        return
+    with portalocker.Lock(cfg['file_games'], 'rb+', **lock_args) as f:
+        data = f.read()
+        if data and not data.endswith(b'\n'):
+            print('[Warning] Removing partially written game from the games file')
+            f.truncate(data.rfind(b'\n') + 1)
         
 def load_all_games() -> List[Game]:
     if not os.path.exists(cfg['file_games']):
         return []
     with portalocker.Lock(cfg['file_games'], 'r', **lock_args) as f:
         data = f.readlines()
-    return [Game(str=s.strip()) for s in data]
+    # unterminated last line is a partially written game
+    return [Game(str=s.strip()) for s in data if s.endswith('\n')]
 
 def save_all_games(games: List[Game]) -> None:
     with portalocker.Lock(cfg['file_games'], 'w', **lock_args) as f:
         for g in games:
             f.write(str(g) + '\n')
+    if os.path.exists(cfg['file_games_store']):
+        os.remove(cfg['file_games_store'])
+
+def remove_games(store: GameStore, indices: np.ndarray) -> GameStore:
+    # rewrites the games file without the selected games, lines are copied without parsing them
+    keep = np.ones(len(store), dtype=bool)
+    keep[indices] = False
+    with portalocker.Lock(cfg['file_games'], 'rb+', **lock_args) as f:
+        lines = [line for line in f.read().splitlines(keepends=True) if line.strip()]
+        kept_lines = [line for line, k in zip(lines, keep) if k]
+        f.seek(0)
+        f.write(b''.join(kept_lines))
+        f.truncate()
+    store = store.select(np.flatnonzero(keep))
+    store.offset = sum(len(line) for line in kept_lines)
+    store.checksum = zlib.crc32(kept_lines[-1]) if kept_lines else 0
+    save_game_store(store)
+    return store
+
+def save_game_store(store: GameStore) -> None:
+    data = {'names': np.array(store.names, dtype=str), 'players': store.players, 'ranks': store.ranks, 'errors': store.errors,
+            'meta': np.array([store.offset, store.checksum], dtype=np.int64)}
+    data.update({f'td:{var}': c for var, c in store.test_data.items()})
+    data.update({f'pd:{var}': c for var, c in store.player_data.items()})
+    # store is only a cache, so failing to replace it (e.g. concurrent show on windows) is not an error
+    tmp_path = cfg['file_games_store'] + f'.{os.getpid()}'
+    try:
+        with open(tmp_path, 'wb') as f:
+            np.savez(f, **data)
+        os.replace(tmp_path, cfg['file_games_store'])
+    except OSError:
+        if os.path.exists(tmp_path):
+            os.remove(tmp_path)
+
+def load_game_store() -> GameStore:
+    # loads the cached columnar store and appends all of the games added since the last update
+    store = None
+    if os.path.exists(cfg['file_games_store']):
+        try:
+            with np.load(cfg['file_games_store']) as data:
+                store = GameStore(names=data['names'].tolist(), players=data['players'], ranks=data['ranks'], errors=data['errors'],
+                                  test_data={k[3:]: data[k] for k in data.files if k.startswith('td:')},
+                                  player_data={k[3:]: data[k] for k in data.files if k.startswith('pd:')},
+                                  offset=int(data['meta'][0]), checksum=int(data['meta'][1]))
+        except (OSError, ValueError, KeyError):
+            store = None
 
-# TODO: write to string first and then output with a single call?
-saving_db = False
+    if not os.path.exists(cfg['file_games']):
+        return GameStore()
+
+    with portalocker.Lock(cfg['file_games'], 'rb', **lock_args) as f:
+        if store is not None:
+            # games file was rewritten if the last included line doesn't match anymore
+            size = f.seek(0, os.SEEK_END)
+            f.seek(max(0, store.offset - 64 * 1024))
+            tail = f.read(store.offset - f.tell()) if store.offset <= size else b''
+            last_line = tail[tail.rfind(b'\n', 0, len(tail) - 1) + 1:]
+            if store.offset > size or zlib.crc32(last_line) != store.checksum:
+                store = None
+        if store is None:
+            store = GameStore()
+        f.seek(store.offset)
+        data = f.read()
+
+    # unterminated last line is a partially written game
+    end = data.rfind(b'\n') + 1
+    if end == 0:
+        return store
+    lines = data[:end].decode('UTF-8').splitlines()
+    store.append([Game(str=line.strip()) for line in lines if line.strip()])
+    store.offset += end
+    store.checksum = zlib.crc32(data[data.rfind(b'\n', 0, end - 1) + 1:end])
+    save_game_store(store)
+    return store
+
+# Journal contains batches of updated bots (same format as .db), each batch ends with "#COMMIT : games_count"
+# .db + complete batches of the journal = current state; games_count tells how many games it already includes
+# .db starts with "#GENERATION : N" & the journal with "#BASE : N", a journal is only replayed over the .db it was started for
+
+def append_journal(bots: List[Bot], games_count: int) -> None:
+    with portalocker.Lock(cfg['file_journal'], 'a', **lock_args) as f:
+        f.write(''.join(f'{str(b)}\n' for b in bots) + f'#COMMIT : {games_count}\n')
+
+def load_journal(generation: int) -> Tuple[List[Bot], int]:
+    if not os.path.exists(cfg['file_journal']):
+        return [], None
+    with portalocker.Lock(cfg['file_journal'], 'r', **lock_args) as f:
+        data = f.readlines()
+    # journal of another generation is left over from an interrupted compaction, its entries are already in .db
+    if not data or data[0] != f'#BASE : {generation}\n':
+        return [], None
+    bots = []
+    batch = []
+    games_count = None
+    for line in data[1:]:
+        # incomplete last batch (no newline or no commit) is ignored
+        if not line.endswith('\n'):
+            break
+        if line.startswith('#COMMIT'):
+            bots += batch
+            batch = []
+            games_count = int(line.split(':')[1])
+        else:
+            batch.append(Bot.from_str(line.strip()))
+    return bots, games_count
+
+def load_db_file() -> Tuple[Dict[str, Bot], int]:
+    # returns bots & generation of .db (without the journal)
+    if not os.path.exists(cfg['file_db']):
+        return {}, 0
+    with portalocker.Lock(cfg['file_db'], 'r', **lock_args) as f:
+        data = f.readlines()
+    generation = int(data.pop(0).split(':')[1]) if data and data[0].startswith('#GENERATION') else 0
+    return {b.name: b for b in [Bot.from_str(line.strip()) for line in data]}, generation
 
 def save_db(bots: Dict[str, Bot]) -> None:
-    global saving_db
-    saving_db = True
-    with portalocker.Lock(cfg['file_db'], 'w', **lock_args) as f:
-        for b in bots.values():
-            f.write(f'{str(b)}\n')
-    saving_db = False
+    # compaction: replaces .db with a new generation & resets the journal, assumes that all games have been already added
+    # .db is replaced atomically, so a crash leaves either the old .db & its journal or the new .db & a stale journal
+    generation = load_db_file()[1] + 1
+    tmp_path = cfg['file_db'] + f'.{os.getpid()}'
+    with open(tmp_path, 'w') as f:
+        f.write(f'#GENERATION : {generation}\n' + ''.join(f'{str(b)}\n' for b in bots.values()))
+        f.flush()
+        os.fsync(f.fileno())
+    os.replace(tmp_path, cfg['file_db'])
+    with portalocker.Lock(cfg['file_journal'], 'w', **lock_args) as f:
+        f.write(f'#BASE : {generation}\n#COMMIT : {count_games()}\n')
 
 def load_db() -> Dict[str, Bot]:
-    if not os.path.exists(cfg['file_db']):
+    bots, generation = load_db_file()
+    # journal entries are absolute, so replaying them is idempotent
+    for b in load_journal(generation)[0]:
+        bots[b.name] = b
+    return bots
+
+# Checkpoint = ratings of all bots after the first N games of the games file. It stores the byte offset & crc32
+# of these N games, so any rewrite of the games file (e.g. bot removal) only invalidates the checkpoints after it
+
+def model_fingerprint(model: str) -> str:
+    return f'{model}:{cfg["model_tau"]}:{cfg["model_draw_prob"]}:{cfg["skip_errors"]}'
+
+def games_file_prefixes(rows: List[int]) -> Dict[int, Tuple[int, int]]:
+    # returns (byte offset, crc32) of the first N games of the games file for every N in rows
+    if not os.path.exists(cfg['file_games']):
         return {}
-    with portalocker.Lock(cfg['file_db'], 'r', **lock_args) as f:
-        data = f.readlines()
-    bots = [Bot.from_str(line.strip()) for line in data]
-    return {b.name: b for b in bots}    
+    with portalocker.Lock(cfg['file_games'], 'rb', **lock_args) as f:
+        data = f.read()
+    line_ends = np.flatnonzero(np.frombuffer(data, dtype=np.uint8) == ord('\n')) + 1
+    line_starts = np.concatenate([[0], line_ends[:-1]])
+    row_ends = line_ends[line_ends - line_starts > 1] # empty lines are not games
+    prefixes = {}
+    pos = 0
+    crc = 0
+    for row in sorted(set(rows)):
+        if row > len(row_ends):
+            break
+        end = int(row_ends[row - 1]) if row else 0
+        crc = zlib.crc32(data[pos:end], crc)
+        pos = end
+        prefixes[row] = (end, crc)
+    return prefixes
+
+def checkpoint_state(bots: Dict[str, Bot]) -> Dict[str, List]:
+    return {b.name: [b.mu, b.sigma, b.games, b.errors] for b in bots.values() if b.games}
+
+def read_checkpoints() -> List[Dict[str, Any]]:
+    # returns only checkpoints that are still valid for the current games file
+    if not os.path.exists(cfg['file_checkpoints']):
+        return []
+    with portalocker.Lock(cfg['file_checkpoints'], 'r', **lock_args) as f:
+        checkpoints = [json.loads(line) for line in f.readlines() if line.endswith('\n')]
+    prefixes = games_file_prefixes([cp['games'] for cp in checkpoints])
+    return [cp for cp in checkpoints if prefixes.get(cp['games']) == (cp['offset'], cp['crc'])]
+
+def load_checkpoints(model: str) -> List[Dict[str, Any]]:
+    fingerprint = model_fingerprint(model)
+    return sorted([cp for cp in read_checkpoints() if cp['model'] == fingerprint], key=lambda cp: cp['games'])
+
+def save_checkpoints(model: str, states: Dict[int, Dict[str, List]], replace: bool=False) -> None:
+    # states: games count -> checkpoint_state; replace drops all other checkpoints of this model
+    fingerprint = model_fingerprint(model)
+    prefixes = games_file_prefixes(list(states.keys()))
+    checkpoints = [cp for cp in read_checkpoints() if cp['model'] != fingerprint or (not replace and cp['games'] not in states)]
+    for games, state in states.items():
+        if games in prefixes:
+            checkpoints.append({'model': fingerprint, 'games': games, 'offset': prefixes[games][0], 'crc': prefixes[games][1], 'bots': state})
+    with portalocker.Lock(cfg['file_checkpoints'], 'w', **lock_args) as f:
+        f.write(''.join(json.dumps(cp) + '\n' for cp in sorted(checkpoints, key=lambda cp: (cp['model'], cp['games']))))
+
+def recover_db() -> Tuple[Dict[str, Bot], List[Game]]:
+    repair_games()
+    bots = load_db()
+    games = load_game_store().to_games()
+    games_count = load_journal(load_db_file()[1])[1]
+    if games_count is not None and games_count < len(games):
+        print(f'[Warning] Recovering {len(games) - games_count} games missing from the journal')
+        update_ranking(bots, games[games_count:])
+    save_db(bots)
+    return bots, games
 
 #endregion
 
@@ -324,18 +650,139 @@ def update_ranking(bots: Dict[str, Bot], games: Union[List[Game], Game], whole_r
             
 
 
-def recalculate_ranking(bots: Dict[str, Bot], games: List[Game], model: str = None) -> Dict[str, Bot]:
+def rate_games(bots: Dict[str, Bot], store: GameStore, indices: np.ndarray, model: str) -> None:
+    # same as update_ranking, but uses the native kernel (when available) for trueskill
+    if model != 'trueskill' or _rating is None:
+        update_ranking(bots, store.to_games(indices), whole_ranking=True, model=model)
+        return
+
+    ts.setup(tau=cfg['model_tau'], draw_probability=cfg['model_draw_prob'])
+    default = Bot('', '')
+    state = [bots.get(name, default) for name in store.names]
+    mu = np.array([b.mu for b in state], dtype=np.float64)
+    sigma = np.array([b.sigma for b in state], dtype=np.float64)
+    games = np.array([b.games for b in state], dtype=np.int64)
+    errors = np.array([b.errors for b in state], dtype=np.int64)
+    _rating.trueskill_rate(np.ascontiguousarray(store.players[indices], dtype=np.int32), np.ascontiguousarray(store.ranks[indices], dtype=np.int32),
+                           np.ascontiguousarray(store.errors[indices], dtype=np.int32), cfg['n_players'], mu, sigma, games, errors,
+                           cfg['model_tau'], ts.global_env().beta, cfg['model_draw_prob'], cfg['skip_errors'])
+    for i, name in enumerate(store.names):
+        if name in bots:
+            bots[name].mu, bots[name].sigma, bots[name].games, bots[name].errors = float(mu[i]), float(sigma[i]), int(games[i]), int(errors[i])
+
+
+def recalculate_ranking(bots: Dict[str, Bot], store: GameStore, indices: np.ndarray = None, model: str = None, use_checkpoints: bool = True) -> Dict[str, Bot]:
+    # recalculates ranking using store games with selected indices (all by default, in order)
+    model = model or cfg['model']
+    indices = np.arange(len(store)) if indices is None else np.asarray(indices, dtype=np.int64)
     new_bots = {b.name: Bot(name=b.name, description=b.description, active=b.active, cdate=b.cdate) for b in bots.values()}
-    for game in games:
-        for player in game.players:
-            if player not in new_bots:
-                new_bots[player] = Bot(name=player, description='n/a')
-    update_ranking(new_bots, games, whole_ranking=True, progress_bar=cfg['show_progress'], model=model)
+    for player in np.unique(store.players[indices]):
+        if store.names[player] not in new_bots:
+            new_bots[store.names[player]] = Bot(name=store.names[player], description='n/a')
+
+    if model == 'global':
+        update_ranking(new_bots, store.to_games(indices), whole_ranking=True, progress_bar=cfg['show_progress'], model=model)
+        return new_bots
+
+    # as long as the selected games are the first games of the games file, the ratings can be (check)pointed
+    mismatch = np.flatnonzero(indices != np.arange(len(indices)))
+    prefix = int(mismatch[0]) if len(mismatch) else len(indices)
+    start = 0
+    if use_checkpoints and prefix >= cfg['checkpoint_interval']:
+        checkpoints = [cp for cp in load_checkpoints(model) if cp['games'] <= prefix]
+        if checkpoints:
+            start = checkpoints[-1]['games']
+            for name, (mu, sigma, games, errors) in checkpoints[-1]['bots'].items():
+                if name not in new_bots:
+                    new_bots[name] = Bot(name=name, description='n/a')
+                new_bots[name].mu, new_bots[name].sigma, new_bots[name].games, new_bots[name].errors = mu, sigma, games, errors
+
+    interval = cfg['checkpoint_interval']
+    boundaries = list(range((start // interval + 1) * interval, prefix + 1, interval))
+    states = {}
+    progress_bar = tqdm(total=len(indices) - start) if cfg['show_progress'] else None
+    for end in boundaries + [len(indices)]:
+        rate_games(new_bots, store, indices[start:end], model)
+        if progress_bar:
+            progress_bar.update(end - start)
+        if end in boundaries:
+            states[end] = checkpoint_state(new_bots)
+        start = end
+    if progress_bar:
+        progress_bar.close()
+    if states or not use_checkpoints:
+        save_checkpoints(model, states, replace=not use_checkpoints)
     return new_bots
 
 
-def play_games(bots: List[str], verbose: bool=False) -> Union[Game, List[Game]]:
+def _bootstrap_init(config: Dict[str, Any], state: Tuple) -> None:
+    # runs once in every bootstrap worker process
+    global cfg, bootstrap_state
+    cfg = config
+    bootstrap_state = state
+
+
+def _bootstrap_pass(seed: np.random.SeedSequence) -> Dict[str, float]:
+    # single resample & rate pass, bots that weren't sampled get nan
+    bots, store, selected, sample_size, model = bootstrap_state
+    indices = np.random.default_rng(seed).choice(selected, size=sample_size, replace=True)
+    new_bots = recalculate_ranking(bots, store, indices, model=model)
+    return {name: new_bots[name].mu - 3 * new_bots[name].sigma if new_bots[name].games else np.nan for name in bots}
+
+
+def bootstrap_ranking(bots: Dict[str, Bot], store: GameStore, selected: np.ndarray, passes: int, sample_size: int, model: str = None, jobs: int = None) -> Dict[str, np.ndarray]:
+    # runs independent resample & rate passes in a process pool, returns scores of each bot (one per pass)
+    jobs = min(jobs or os.cpu_count() or 1, passes)
+    state = (bots, store, selected, sample_size, model)
+    results = []
+    progress_bar = tqdm(total=passes) if cfg['show_progress'] else None
+    with concurrent.futures.ProcessPoolExecutor(jobs, initializer=_bootstrap_init, initargs=(dict(cfg, show_progress=False), state)) as executor:
+        for result in executor.map(_bootstrap_pass, np.random.SeedSequence().spawn(passes)):
+            results.append(result)
+            if progress_bar:
+                progress_bar.update()
+    if progress_bar:
+        progress_bar.close()
+    return {name: np.array([r[name] for r in results]) for name in bots}
+
+
+def available_cores() -> List[int]:
+    return sorted(os.sched_getaffinity(0)) if hasattr(os, 'sched_getaffinity') else list(range(os.cpu_count() or 1))
+
+
+def worker_cores(n_workers: int) -> Tuple[int, List[List[int]]]:
+    # splits available cores between workers (cores_per_worker each), returns the (possibly reduced) number of workers & their cores
+    k = cfg['cores_per_worker']
+    if not k:
+        return n_workers, [None] * n_workers
+    if not hasattr(os, 'sched_setaffinity'):
+        print('Warning: cores_per_worker is only supported on linux, games are not going to be pinned')
+        return n_workers, [None] * n_workers
+    cores = available_cores()
+    if n_workers * k > len(cores):
+        n_workers = max(1, len(cores) // k)
+        print(f'Warning: only {len(cores)} cores are available, reducing the number of workers to {n_workers}')
+    return n_workers, [cores[i*k:(i+1)*k] or cores for i in range(n_workers)]
+
+
+def throttle_step(stats: List[Tuple[float, bool]]) -> int:
+    # stats: (system load, had errors) of the recent games; returns the change of the number of active workers
+    # errors are considered to be caused by load if the more loaded half of the games has clearly more of them than the other half
+    loads = np.array([load for load, _ in stats])
+    errors = np.array([error for _, error in stats], dtype=np.float64)
+    high = loads > np.median(loads)
+    if not high.any() or high.all():
+        return +1
+    rate_high, rate_low = errors[high].mean(), errors[~high].mean()
+    if errors.sum() >= 5 and rate_high > 2 * rate_low + 0.01:
+        return -1
+    return +1
+
+
+def play_games(bots: List[str], verbose: bool=False, seed: int=None, pair: int=None, cores: List[int]=None) -> Union[Game, List[Game]]:
     # TODO: add error handling?
+    # seed replaces %SEED% (a random one is used if not provided), pair is stored in test_data of the produced games
+    # cores (linux only): the whole game (referee & bots) is pinned to them, they also replace %CORES% (empty without pinning)
     cmd = cfg['cmd_play_game']
     if '%ALL_PLAYERS%' in cmd:
         words = cmd.split()
@@ -345,6 +792,8 @@ def play_games(bots: List[str], verbose: bool=False) -> Union[Game, List[Game]]:
         cmd = ' '.join(words)
         
     cmd = cmd.replace('%DIR%', cfg['dir_bots'])
+    cmd = cmd.replace('%SEED%', str(seed if seed is not None else random.randrange(2**31)))
+    cmd = cmd.replace('%CORES%', ','.join(map(str, cores or [])))
     for i in range(4):
         tag = f'%P{i+1}%'
         if tag in cmd:
@@ -353,16 +802,28 @@ def play_games(bots: List[str], verbose: bool=False) -> Union[Game, List[Game]]:
     if verbose:
         print(f'Playing Game: {cmd}')
     
+    cpu_time = None
     if os.name == 'nt': # windows
         task = subprocess.run(cmd, shell=True, stdout=subprocess.PIPE, creationflags=subprocess.CREATE_NEW_PROCESS_GROUP)
+        returncode, stdout = task.returncode, task.stdout
     else: 
-        task = subprocess.run(cmd, shell=True, stdout=subprocess.PIPE, preexec_fn=lambda: signal.signal(signal.SIGINT, signal.SIG_IGN))
+        def preexec() -> None:
+            signal.signal(signal.SIGINT, signal.SIG_IGN)
+            if cores:
+                os.sched_setaffinity(0, cores)
+        # wait4 instead of wait, so that we get the cpu time of the whole game (includes all of the waited-for descendants)
+        proc = subprocess.Popen(cmd, shell=True, stdout=subprocess.PIPE, preexec_fn=preexec)
+        stdout = proc.stdout.read()
+        proc.stdout.close()
+        _, status, rusage = os.wait4(proc.pid, 0)
+        returncode = proc.returncode = os.waitstatus_to_exitcode(status)
+        cpu_time = rusage.ru_utime + rusage.ru_stime
             
-    if task.returncode:
-        print(f'Fatal Error: Play Game command {cmd} returned with return code {task.returncode}')
+    if returncode:
+        print(f'Fatal Error: Play Game command {cmd} returned with return code {returncode}')
         os._exit(1)
         
-    output = task.stdout.decode('UTF-8').strip()
+    output = stdout.decode('UTF-8').strip()
     if verbose:
         print(f'{cmd} produced output: {output}')
     
@@ -372,15 +833,92 @@ def play_games(bots: List[str], verbose: bool=False) -> Union[Game, List[Game]]:
         print(f'[Error] Play Game command {cmd} produced invalid JSON: {output}')
         sys.exit(1)
 
+    # cpu time (in seconds, split evenly between the produced games) & system load (per available core) at the end of the game
+    load = os.getloadavg()[0] / len(available_cores()) if hasattr(os, 'getloadavg') else None
+    for d in data if isinstance(data, list) else [data]:
+        d['players'] = bots
+        if pair is not None:
+            d['test_data']['pair'] = pair
+        if cpu_time is not None:
+            d['test_data']['cpu_time'] = round(cpu_time / (len(data) if isinstance(data, list) else 1), 3)
+        if load is not None:
+            d['test_data']['load'] = round(load, 3)
+
     if (isinstance(data, dict)):
-        data['players'] = bots
         return Game(str=json.dumps(data))
     else:
-        for d in data:
-            d['players'] = bots
         return [Game(str=json.dumps(d)) for d in data]
 
 
+def elo_to_score(elo: float) -> float:
+    return 1 / (1 + 10 ** (-elo / 400))
+
+
+def score_to_elo(score: float) -> float:
+    score = min(max(score, 1e-6), 1 - 1e-6)
+    return -400 * math.log10(1 / score - 1)
+
+
+def pair_points(games: List[Game], name: str) -> float:
+    # points scored by the bot in a pair of 1v1 games (1 for a win, 0.5 for a draw)
+    points = 0.0
+    for game in games:
+        me = game.players.index(name)
+        points += 1.0 if game.ranks[me] < game.ranks[1 - me] else 0.5 if game.ranks[me] == game.ranks[1 - me] else 0.0
+    return points
+
+
+def sprt_llr(pentanomial: List[int], elo0: float, elo1: float) -> float:
+    # GSPRT log-likelihood ratio of H1 (elo = elo1) vs H0 (elo = elo0), normal approximation over game pairs
+    # pentanomial[i] is the number of pairs where the first bot scored i/2 points
+    # the variance also counts a pseudo pair (split between 0-2 & 2-0), so that it doesn't collapse after a few identical pairs
+    counts = np.array(pentanomial, dtype=np.float64)
+    scores = np.arange(5) / 4
+    mean = (counts * scores).sum() / counts.sum()
+    counts += [0.5, 0, 0, 0, 0.5]
+    var = (counts * (scores - mean) ** 2).sum() / counts.sum()
+    s0, s1 = elo_to_score(elo0), elo_to_score(elo1)
+    return sum(pentanomial) * (s1 - s0) * (2 * mean - s0 - s1) / (2 * var)
+
+
+def match_priorities(bots: List[Bot]) -> np.ndarray:
+    # priority of every pair of bots = probability that their order in the ranking is wrong, i.e. P(mu1 - mu2 has the opposite sign)
+    # it's high for close mu and/or high sigma, and a game between them resolves most of it; pairs involving the top bots count twice
+    mu = np.array([b.mu for b in bots])
+    sigma = np.array([b.sigma for b in bots])
+    z = np.abs(mu[:, None] - mu[None, :]) / np.sqrt(sigma[:, None] ** 2 + sigma[None, :] ** 2)
+    priority = np.frompyfunc(math.erfc, 1, 1)(z / math.sqrt(2)).astype(np.float64) / 2
+    top = np.zeros(len(bots), dtype=bool)
+    top[np.argsort(-(mu - 3 * sigma))[:cfg['mm_top_bots']]] = True
+    priority[top[:, None] | top[None, :]] *= 2
+    np.fill_diagonal(priority, 0)
+    return priority
+
+
+def choose_match_info_gain(l_bots: List[Bot], p1: Bot = None) -> List[str]:
+    # pairs are sampled proportionally to their priority (instead of always taking the best one), so that the games queued
+    # before the ratings are updated are still spread out; remaining players are added based on the total priority with the chosen ones
+    n = len(l_bots)
+    priority = match_priorities(l_bots)
+    if p1 is not None:
+        chosen = [l_bots.index(p1)]
+    elif priority.sum() > 0:
+        chosen = list(divmod(random.choices(range(n * n), weights=priority.ravel())[0], n))
+    else:
+        chosen = [random.randrange(n)]
+    while len(chosen) < cfg['n_players']:
+        weights = priority[chosen].sum(axis=0)
+        weights[chosen] = 0
+        candidates = [i for i in range(n) if i not in chosen]
+        if weights.sum() > 0:
+            chosen.append(random.choices(candidates, weights=weights[candidates])[0])
+        else:
+            chosen.append(random.choice(candidates))
+    players = [l_bots[i].name for i in chosen]
+    random.shuffle(players)
+    return players
+
+
 def choose_match(bots: Dict[str, Bot]) -> List[str]:
     l_bots = [b for b in bots.values() if b.active]
 
@@ -392,8 +930,13 @@ def choose_match(bots: Dict[str, Bot]) -> List[str]:
     selected_bot = None
     if len(min_bots) and random.random() < cfg['mm_min_matches_preference']:
         p1 = random.choice(min_bots)
+    elif cfg['mm_mode'] == 'info_gain':
+        return choose_match_info_gain(l_bots)
     else:
         p1 = random.choice(l_bots)
+
+    if cfg['mm_mode'] == 'info_gain':
+        return choose_match_info_gain(l_bots, p1)
         
     # find remaining players
     while True:
@@ -434,31 +977,62 @@ def mode_run() -> None:
     if not args.silent:
         print('Starting Psyleague server, press Ctrl+C to kill it')
     
-    bots = load_db()
-    games = load_all_games()
+    bots, games = recover_db()
     
+    n_workers = args.workers if args.workers is not None else cfg['n_workers']
+    n_workers, cores = worker_cores(n_workers)
+    # workers with index >= active_workers are paused (see throttle_workers)
+    active_workers = n_workers
+    workers_cond = threading.Condition()
+    throttle_stats = []
+    if cfg['throttle_workers'] and not hasattr(os, 'getloadavg'):
+        print('Warning: throttle_workers is not supported on this platform')
+    if cfg['mm_pairs'] and '%SEED%' not in cfg['cmd_play_game']:
+        print('Warning: mm_pairs is enabled, but cmd_play_game doesn\'t use %SEED%, games of a pair are only going to have the order of players reversed')
     games_played = 0
     games_total = args.games or sys.maxsize
     games_left = games_total
     games_stat = RollingStat(60.0)
-    last_msg_time = time.time()
+    control_sock = open_control_channel()
+    
+    # group commit: results are written once there are no more results waiting
+    games_count = len(games)
+    last_checkpoint = games_count
+    pending_games = []
+    pending_bots = {}
+    last_compaction = time.time()
+    
+    def flush() -> None:
+        nonlocal games_count, last_checkpoint
+        if not pending_games:
+            return
+        add_games(pending_games)
+        games_count += len(pending_games)
+        append_journal(list(pending_bots.values()), games_count)
+        pending_games.clear()
+        pending_bots.clear()
+        # live ratings are identical to a replay of all games, so they can be used as a checkpoint
+        if cfg['model'] != 'global' and games_count // cfg['checkpoint_interval'] > last_checkpoint // cfg['checkpoint_interval']:
+            save_checkpoints(cfg['model'], {games_count: checkpoint_state(bots)})
+            last_checkpoint = games_count
     
     try:
         start_time = time.time()
         
-        def worker_loop() -> None:
+        def worker_loop(index: int) -> None:
             while True:
                 try:
-                    players = games_queue.get(block=False)
-                    if players is None: 
+                    with workers_cond:
+                        workers_cond.wait_for(lambda: index < active_workers)
+                    job = games_queue.get()
+                    if job is None: 
                         break
-                    games = play_games(players, args.verbose)
+                    players, seed, pair = job
+                    games = play_games(players, args.verbose, seed, pair, cores[index])
                     if isinstance(games, Game):
                         games = [games]
                     for game in games:
-                        results_queue.put(game)
-                except queue.Empty:
-                    time.sleep(0.1)
+                        events_queue.put(('game', game))
                 except KeyboardInterrupt:
                     print('Worker Interrupted, this should never happen!')
                     break
@@ -467,13 +1041,95 @@ def mode_run() -> None:
                     traceback.print_exc()
                     os._exit(1)
                     
+        def control_loop() -> None:
+            while True:
+                try:
+                    control_sock.recvfrom(64)
+                except socket.timeout:
+                    if not os.path.exists(cfg['file_msg']) or os.path.getsize(cfg['file_msg']) == 0:
+                        continue
+                except OSError:
+                    break # socket closed during shutdown
+                events_queue.put(('msg', None))
                     
-        workers = [Thread(target=worker_loop) for _ in range(args.workers if args.workers is not None else cfg['n_workers'])]
+        workers = [Thread(target=worker_loop, args=(i,)) for i in range(n_workers)]
         for worker in workers:
             worker.start()
+        Thread(target=control_loop, daemon=True).start()
+        
+        # pick up messages sent while the server was offline
+        events_queue.put(('msg', None))
             
         while True:
-            time.sleep(0.1)
+            # add new games to the queue, so that workers never wait for the scheduler
+            while games_queue.qsize() < active_workers * 2 and games_left > 0:
+                players = choose_match(bots)
+                if players is None: 
+                    break
+                if cfg['mm_pairs']:
+                    # both games of a pair are next to each other in the queue, so they're played at the same time by two workers
+                    seed, pair = random.randrange(2**31), random.getrandbits(48)
+                    games_queue.put((players, seed, pair))
+                    games_queue.put((players[::-1], seed, pair))
+                    games_left -= 2
+                else:
+                    games_queue.put((players, None, None))
+                    games_left -= 1
+            # TODO: add games_left == 0 handling                
+            
+            if not args.silent and not args.verbose:
+                active_bots = sum([1 for b in bots.values() if b.active])
+                throttled = f'  Workers: {active_workers} / {n_workers}' if active_workers < n_workers else ''
+                print(f'\rActive Bots: {active_bots}  Games since launch: {games_played}{f' / {games_total}' if args.games else ''}  Games in the last 60s: {games_stat.get_count()}{throttled}                    \r', end='')
+            
+            if games_played >= games_total:
+                break
+            
+            if time.time() - last_compaction > cfg['db_compaction_interval']:
+                flush()
+                save_db(bots)
+                last_compaction = time.time()
+            
+            # timeout only refreshes the status line (and keeps Ctrl+C responsive on Windows)
+            try:
+                event_type, game = events_queue.get(timeout=1.0)
+            except queue.Empty:
+                continue
+            
+            # process result
+            if event_type == 'game':
+                if args.verbose:
+                    print(f'Processing result: {game.players}, outcome: {game.ranks}')
+                if any([player not in bots for player in game.players]):
+                    print(f'Warning: Unknown bot in game: {game.players}; skipping game')
+                    games_left += 1 # schedule a replacement, otherwise --games would never finish
+                    continue
+                update_ranking(bots, game)
+                pending_games.append(game)
+                for player in game.players:
+                    pending_bots[player] = bots[player]
+                games_played += 1
+                games_stat.add()
+                if cfg['throttle_workers'] and 'load' in game.test_data:
+                    throttle_stats.append((game.test_data['load'], any(game.errors)))
+                    if len(throttle_stats) >= cfg['throttle_window']:
+                        change = throttle_step(throttle_stats)
+                        throttle_stats.clear()
+                        with workers_cond:
+                            new_active_workers = min(max(active_workers + change, 1), n_workers)
+                            if new_active_workers != active_workers:
+                                log(f'[Throttle] Active workers: {active_workers} -> {new_active_workers}')
+                                if not args.silent:
+                                    reason = 'errors correlate with load' if change < 0 else 'errors don\'t correlate with load'
+                                    print(f'Throttling: {reason}, active workers: {new_active_workers}' + ' '*40)
+                                active_workers = new_active_workers
+                                workers_cond.notify_all()
+                if events_queue.empty():
+                    flush()
+                continue
+            
+            # messages can rewrite the whole db, so all of the results have to be committed first
+            flush()
             
             # retrieve and process all messages
             for msg in receive_msgs():
@@ -507,51 +1163,20 @@ def mode_run() -> None:
                     bots[name].active = 0
                     save_db(bots)
                 elif msg_type == 'REMOVE_BOT':
-                    games = load_all_games()
-                    games_no = len(games)
                     name = a[1]
-                    games = [g for g in games if name not in g.players]
-                    print(f'Removed {games_no - len(games)} games')
+                    store = load_game_store()
+                    removed = store.games_of(name)
+                    store = remove_games(store, removed)
+                    print(f'Removed {len(removed)} games')
                     del bots[name]
                     print('Recalculating ranking...')
-                    bots = recalculate_ranking(bots, games)
-                    save_all_games(games)
+                    bots = recalculate_ranking(bots, store)
                     save_db(bots)
+                    # the games file was rewritten, so the journal commits and checkpoints count from its new size
+                    games_count = len(store)
+                    last_checkpoint = games_count
                 else:
                     assert False, f'Unknown message type: {msg_type}'
-                
-            # add new games to the queue
-            while games_queue.qsize() < cfg['n_workers'] * 2 and games_left > 0:
-                players = choose_match(bots)
-                if players is None: 
-                    break
-                games_left -= 1
-                games_queue.put(players)
-            # TODO: add games_left == 0 handling                
-            
-            # process results
-            try:
-                while True:
-                    game = results_queue.get(block=False)
-                    if args.verbose:
-                        print(f'Processing result: {game.players}, outcome: {game.ranks}')
-                    if any([player not in bots for player in game.players]):
-                        print(f'Warning: Unknown bot in game: {game.players}; skipping game')
-                        continue
-                    add_game(game)
-                    update_ranking(bots, game)
-                    save_db(bots) 
-                    games_played += 1
-                    games_stat.add()
-            except queue.Empty:
-                pass
-                
-            if not args.silent and not args.verbose:
-                active_bots = sum([1 for b in bots.values() if b.active])
-                print(f'\rActive Bots: {active_bots}  Games since launch: {games_played}{f' / {games_total}' if args.games else ''}  Games in the last 60s: {games_stat.get_count()}                    \r', end='')
-            
-            if games_played >= games_total:
-                break
             
     except KeyboardInterrupt:
         print('\nInterrupted by user, waiting for all workers to finish!')
@@ -562,8 +1187,11 @@ def mode_run() -> None:
         traceback.print_exc()
         os._exit(1)
 
-    if saving_db:
-        save_db(bots)        
+    # ctrl+c could interrupt writing, so it's safer to always compact at the end
+    flush()
+    save_db(bots)
+
+    close_control_channel(control_sock)
 
     # stop running any new games
     try:
@@ -572,6 +1200,9 @@ def mode_run() -> None:
     except:
         pass
 
+    with workers_cond:
+        active_workers = n_workers
+        workers_cond.notify_all()
     for _ in workers:
         games_queue.put(None)
 
@@ -729,26 +1360,32 @@ def mode_show() -> None:
     log('[Action] Show')
 
     bots = load_db()
-    games = load_all_games()
+    store = load_game_store()
+    selected = np.arange(len(store))
 
-    if args.resample or args.filters or args.include or args.exclude or args.model or cfg['model'] == 'global':
+    if (args.resample and not args.bootstrap) or args.filters or args.include or args.exclude or args.model or cfg['model'] == 'global':
         if args.filters:
-            available_vars = {var for game in games for var in game.test_data}
+            mask = np.ones(len(store), dtype=bool)
             for filter in args.filters:
                 var, value = filter.split('=')
-                if var not in available_vars:
-                    print(f'[Error] There are no games with: {var} available vars: {available_vars}')
+                if var not in store.test_data:
+                    print(f'[Error] There are no games with: {var} available vars: {set(store.test_data)}')
                     sys.exit(1)
-                games = [game for game in games if var in game.test_data]
+                column = store.test_data[var]
+                is_str = column.dtype.kind == 'U'
+                mask &= column != '' if is_str else ~np.isnan(column)
+                if not mask.any():
+                    break
+                convert = str if is_str else try_str_to_numeric
                 if '-' in value:
                     lo, hi = value.split('-')
-                    lo = try_str_to_numeric(lo) if lo else min([game.test_data[var] for game in games])
-                    hi = try_str_to_numeric(hi) if hi else max([game.test_data[var] for game in games])
-                    games = [game for game in games if lo <= game.test_data[var] <= hi]
+                    lo = convert(lo) if lo else column[mask].min()
+                    hi = convert(hi) if hi else column[mask].max()
+                    mask &= (lo <= column) & (column <= hi)
                 else:
-                    value = try_str_to_numeric(value)
-                    games = [game for game in games if game.test_data[var] == value]
-            if not games:
+                    mask &= column == convert(value)
+            selected = np.flatnonzero(mask)
+            if not len(selected):
                 print(f'[Error] There are no games matching the filters')
                 sys.exit(1)
 
@@ -763,15 +1400,22 @@ def mode_show() -> None:
                 for pattern in args.exclude:
                     players.difference_update([b for b in bots if re.match(pattern, b)])
 
-            games = [game for game in games if all([p in players for p in game.players])]
+            player_ids = [store.bot_id(p) for p in players if store.bot_id(p) is not None]
+            selected = selected[np.isin(store.players[selected], player_ids).all(axis=1)]
             bots = {b: bots[b] for b in players}
                 
-        if args.resample:
-            random.seed(datetime.now())
-            games = random.choices(games, k=args.resample)
+        if args.resample and not args.bootstrap:
+            selected = np.array(random.choices(selected, k=args.resample), dtype=np.int64)
+
+        print(f'Recalculating ranking using {len(selected)} games...')
+        bots = recalculate_ranking(bots, store, selected, model=args.model)
+        print()
 
-        print(f'Recalculating ranking using {len(games)} games...')
-        bots = recalculate_ranking(bots, games, model=args.model)
+    bootstrap = None
+    if args.bootstrap:
+        sample_size = args.resample or len(selected)
+        print(f'Bootstrapping ranking using {args.bootstrap} samples of {sample_size} games...')
+        bootstrap = bootstrap_ranking(bots, store, selected, args.bootstrap, sample_size, model=args.model, jobs=args.jobs)
         print()
 
     ranking = sorted(bots.values(), key=lambda b: b.mu-3*b.sigma, reverse=True)
@@ -807,18 +1451,34 @@ def mode_show() -> None:
         print(f'[Error] Your date_format: "{cfg["date_format"]}" is invalid')
         sys.exit(1)
 
-    player_vars = {b.name: {} for b in ranking}
-    for game in games:
-        for player, data in enumerate(game.player_data):
-            name = game.players[player]
-            if name not in player_vars: 
-                continue
-            for k, v in data.items():
-                player_vars[name][k] = player_vars[name].get(k, 0) + float(v)
+    if bootstrap:
+        lo, hi = (100 - cfg['bootstrap_interval']) / 2, (100 + cfg['bootstrap_interval']) / 2
+        stats = {}
+        for b in ranking:
+            scores = bootstrap[b.name][~np.isnan(bootstrap[b.name])]
+            stats[b.name] = [scores.mean(), scores.std(), *np.percentile(scores, [lo, hi])] if len(scores) else [None] * 4
+        columns['score_mean'] = ('Mean', [stats[b.name][0] for b in ranking])
+        columns['score_std'] = ('Std', [stats[b.name][1] for b in ranking])
+        columns['score_lo'] = (f'P{lo:g}', [stats[b.name][2] for b in ranking])
+        columns['score_hi'] = (f'P{hi:g}', [stats[b.name][3] for b in ranking])
 
+    player_vars = {b.name: {} for b in ranking}
+    selected_players = store.players[selected].ravel()
     vars = set()
-    for name in player_vars:
-        vars.update(player_vars[name])
+    for var, column in store.player_data.items():
+        values = column[selected].ravel()
+        if values.dtype.kind == 'U':
+            values = np.array([float(v) if v else np.nan for v in values], dtype=np.float64)
+        present = ~np.isnan(values)
+        if not present.any():
+            continue
+        vars.add(var)
+        counts = np.bincount(selected_players[present], minlength=len(store.names))
+        totals = np.bincount(selected_players[present], weights=values[present], minlength=len(store.names))
+        for name in player_vars:
+            i = store.bot_id(name)
+            if i is not None and counts[i]:
+                player_vars[name][var] = totals[i]
 
     for var in vars:
         columns[f'pdata:{var}'.lower()] = (var, [player_vars[b.name][var] / b.games if var in player_vars[b.name] else None for b in ranking])
@@ -830,6 +1490,16 @@ def mode_show() -> None:
             for var in sorted(vars, reverse=True):
                 leaderboard.insert(i, f'pdata:{var}')
             break
+
+    bootstrap_columns = ['score_mean.2', 'score_std.2', 'score_lo.2', 'score_hi.2'] if bootstrap else []
+    names = [column_name.lower() for column_name in leaderboard]
+    if 'bootstrap' in names:
+        i = names.index('bootstrap')
+        leaderboard[i:i+1] = bootstrap_columns
+    elif bootstrap_columns:
+        # leaderboard without BOOTSTRAP (older configs), the columns go right after the score
+        i = next((j+1 for j, name in enumerate(names) if name.split('.')[0].rstrip('?') == 'score'), len(leaderboard))
+        leaderboard[i:i] = bootstrap_columns
         
     table = DataTable()
     for column_name in leaderboard:
@@ -862,25 +1532,28 @@ def mode_info() -> None:
     if args.name not in bots:
         print(f'[Error] Bot {args.name} doesn\'t exist')
         sys.exit(1)
-    games = load_all_games()
+    store = load_game_store()
 
     ranking = sorted(bots.values(), key=lambda b: b.mu-3*b.sigma, reverse=True)
 
     enemy_bots = [b for b in ranking if b.name != args.name]
 
-    wins = {b.name: 0 for b in enemy_bots}
-    losses = {b.name: 0 for b in enemy_bots}
-    draws = {b.name: 0 for b in enemy_bots}
+    # head-to-head results, only games played by the bot are scanned (via the per-bot index)
+    bot_games = store.games_of(args.name)
+    players = store.players[bot_games]
+    ranks = store.ranks[bot_games]
+    me = players == store.bot_id(args.name)
+    my_rank = (ranks * me).sum(axis=1, keepdims=True)
+    results = {}
+    for name, outcome in [('wins', my_rank < ranks), ('losses', my_rank > ranks), ('draws', my_rank == ranks)]:
+        results[name] = np.bincount(players[~me], weights=outcome[~me], minlength=len(store.names))
     
-    for game in games:
-        for i, p1 in enumerate(game.players):
-            if p1 == args.name:
-                for j, p2 in enumerate(game.players):
-                    if i == j:
-                        continue
-                    wins[p2]   += int(game.ranks[i]  < game.ranks[j])
-                    losses[p2] += int(game.ranks[i]  > game.ranks[j])
-                    draws[p2]  += int(game.ranks[i] == game.ranks[j])
+    def count(result: str, name: str) -> int:
+        i = store.bot_id(name)
+        return int(results[result][i]) if i is not None else 0
+    wins = {b.name: count('wins', b.name) for b in enemy_bots}
+    losses = {b.name: count('losses', b.name) for b in enemy_bots}
+    draws = {b.name: count('draws', b.name) for b in enemy_bots}
 
     headers = ['Pos', 'Name', 'Score', '%', 'Wins', 'Losses', 'Draws']
     columns = []
@@ -901,6 +1574,119 @@ def mode_info() -> None:
     table.show(args.output or cfg['show_output'])
 
 
+def mode_sprt() -> None:
+    log(f'[Action] SPRT {args.bot1} vs {args.bot2}')
+
+    if cfg['n_players'] != 2:
+        print('[Error] SPRT is only available for 1v1 games')
+        sys.exit(1)
+    bots = load_db()
+    for name in [args.bot1, args.bot2]:
+        if name not in bots:
+            print(f'[Error] Bot {name} doesn\'t exist')
+            sys.exit(1)
+    if args.bot1 == args.bot2:
+        print('[Error] SPRT requires two different bots')
+        sys.exit(1)
+    if args.max_pairs is not None and args.max_pairs < 1:
+        print('[Error] --max-pairs has to be at least 1')
+        sys.exit(1)
+
+    elo0 = args.elo0 if args.elo0 is not None else cfg['sprt_elo0']
+    elo1 = args.elo1 if args.elo1 is not None else cfg['sprt_elo1']
+    alpha = args.alpha if args.alpha is not None else cfg['sprt_alpha']
+    beta = args.beta if args.beta is not None else cfg['sprt_beta']
+    lower, upper = math.log(beta / (1 - alpha)), math.log((1 - beta) / alpha)
+    n_workers = args.workers if args.workers is not None else cfg['n_workers']
+    n_workers, cores = worker_cores(n_workers)
+    print(f'SPRT {args.bot1} vs {args.bot2}: H0 elo = {elo0}, H1 elo = {elo1}, alpha = {alpha}, beta = {beta}, LLR bounds [{lower:.2f}, {upper:.2f}]')
+
+    # each pair is the same match (same %SEED%) with the order of players swapped; games of a pair are next to each other in the queue
+    pairs_queue = queue.Queue()
+    results_queue = queue.Queue()
+
+    def worker_loop(index: int) -> None:
+        while True:
+            try:
+                job = pairs_queue.get()
+                if job is None:
+                    break
+                pair_id, players, seed = job
+                game = play_games(players, args.verbose, seed, cores=cores[index])
+                if not isinstance(game, Game):
+                    print('[Error] SPRT requires cmd_play_game to output a single game')
+                    os._exit(1)
+                results_queue.put((pair_id, game))
+            except:
+                print('Fatal error in one of the workers')
+                traceback.print_exc()
+                os._exit(1)
+
+    workers = [Thread(target=worker_loop, args=(i,)) for i in range(n_workers)]
+    for worker in workers:
+        worker.start()
+
+    pentanomial = [0] * 5
+    pairs_scheduled = 0
+    halves = {}
+    llr = 0.0
+    verdict = None
+    try:
+        while verdict is None:
+            while pairs_queue.qsize() < n_workers * 2 and (args.max_pairs is None or pairs_scheduled < args.max_pairs):
+                seed = random.randrange(2**31)
+                pairs_queue.put((pairs_scheduled, [args.bot1, args.bot2], seed))
+                pairs_queue.put((pairs_scheduled, [args.bot2, args.bot1], seed))
+                pairs_scheduled += 1
+
+            pair_id, game = results_queue.get()
+            halves.setdefault(pair_id, []).append(game)
+            if len(halves[pair_id]) < 2:
+                continue
+            pentanomial[int(pair_points(halves.pop(pair_id), args.bot1) * 2)] += 1
+            pairs = sum(pentanomial)
+            llr = sprt_llr(pentanomial, elo0, elo1)
+            score = sum(i * c for i, c in enumerate(pentanomial)) / (4 * pairs)
+            if not args.verbose:
+                print(f'\rPairs: {pairs}  Pentanomial: {pentanomial}  Elo: {score_to_elo(score):+.1f}  LLR: {llr:.2f} [{lower:.2f}, {upper:.2f}]          \r', end='')
+
+            if llr >= upper:
+                verdict = 'H1'
+            elif llr <= lower:
+                verdict = 'H0'
+            elif pairs == args.max_pairs:
+                verdict = 'inconclusive'
+    except KeyboardInterrupt:
+        verdict = 'interrupted'
+    print()
+
+    messages = {
+        'H1': f'{args.bot1} passed: H1 accepted (elo >= {elo1} against {args.bot2})',
+        'H0': f'{args.bot1} failed: H0 accepted (elo <= {elo0} against {args.bot2})',
+        'inconclusive': f'No verdict after {args.max_pairs} pairs',
+        'interrupted': 'Interrupted by user, no verdict',
+    }
+    print(messages[verdict])
+    pairs = sum(pentanomial)
+    result = {'date': str(datetime.now().replace(microsecond=0)), 'bot1': args.bot1, 'bot2': args.bot2, 'elo0': elo0, 'elo1': elo1, 'alpha': alpha, 'beta': beta,
+              'pairs': pairs, 'pentanomial': pentanomial, 'elo': round(score_to_elo(sum(i * c for i, c in enumerate(pentanomial)) / (4 * pairs)), 2) if pairs else None,
+              'llr': round(llr, 4), 'verdict': verdict}
+    with portalocker.Lock(cfg['file_sprt'], 'a', **lock_args) as f:
+        f.write(json.dumps(result) + '\n')
+    log(f'[SPRT] {json.dumps(result)}')
+
+    # stop running any new games, games in progress are not used
+    try:
+        while True:
+            pairs_queue.get(block=False)
+    except queue.Empty:
+        pass
+    for _ in workers:
+        pairs_queue.put(None)
+    for worker in workers:
+        worker.join()
+
+
 def mode_db_recreate() -> None:
     if not unique_run():
         print('[Error] Psyleague server is already running, aborting...')
@@ -915,42 +1701,40 @@ def mode_db_recreate() -> None:
             return
 
     bots = load_db()
-    games = load_all_games()
     if args.shuffle:
         print('Shuffling games...')
+        games = load_all_games()
         random.shuffle(games)
         save_all_games(games)
     print('Recalculating ranking...')
-    bots = recalculate_ranking(bots, games)
+    bots = recalculate_ranking(bots, load_game_store(), use_checkpoints=not args.full)
     save_db(bots)
 
 
 def mode_db_verify() -> None:
     bots = load_db()
-    games = load_all_games()
+    store = load_game_store()
 
-    if not bots and not games:
+    if not bots and not len(store):
         print('No bots and no games in the database, nothing to verify!')
         return
 
     issues = []
 
-    missing_bots = set()
-    for game in games:
-        for player in game.players:
-            if player not in bots and player not in missing_bots:
-                missing_bots.add(player)
-                issues.append(f'Game {game} contains an unknown player: {player}')
-                print(issues[-1])
+    for name in store.names:
+        bot_games = store.games_of(name)
+        if name not in bots and len(bot_games):
+            issues.append(f'Game {store.to_games(bot_games[:1])[0]} contains an unknown player: {name}')
+            print(issues[-1])
 
     if not issues:
-        verify_bots = recalculate_ranking(bots, games)
+        verify_bots = recalculate_ranking(bots, store, use_checkpoints=False)
         for b in bots.values():
             if b.games != verify_bots[b.name].games:
                 issues.append(f'Bot {b.name} has {b.games} games in the database and {verify_bots[b.name].games} games in the recalculated ranking')
             if b.errors != verify_bots[b.name].errors:
                 issues.append(f'Bot {b.name} has {b.errors} errors in the database and {verify_bots[b.name].errors} errors in the recalculated ranking')
-            if b.mu != verify_bots[b.name].mu:
+            if abs(b.mu - verify_bots[b.name].mu) > RATING_TOLERANCE:
                 issues.append(f'Bot {b.name} has mu {b.mu} in the database and {verify_bots[b.name].mu} in the recalculated ranking')
 
     if not issues:
@@ -995,7 +1779,7 @@ def _main() -> None:
     parser_bot.add_argument('-d', '--description', type=str, default='n/a', help='description of the bot (used in add/update)')
     parser_bot.add_argument('-n', '--new-name', type=str, default=None, help='new name of the bot (used in update)')
 
-    parser_show = subparsers.add_parser('show', aliases=['s'], help='shows the current ranking for all bots\n-s/-f/-i/-x requires recalculating ranking (which may take a while)')
+    parser_show = subparsers.add_parser('show', aliases=['s'], help='shows the current ranking for all bots\n-s/-B/-f/-i/-x requires recalculating ranking (which may take a while)')
     parser_show.set_defaults(func=mode_show)
     parser_show.add_argument('-a', '--active', action='store_true', help='shows only active bots')
     parser_show.add_argument('-o', '--output', choices=['table','csv','json'], default=None, help='output format of the ranking')
@@ -1003,7 +1787,9 @@ def _main() -> None:
     parser_show.add_argument('-f', '--filters', type=str, default=None, nargs='+', help='recalculates ranking after filtering the games)')
     parser_show.add_argument('-i', '--include', type=str, default=None, nargs='+', help='recalculates ranking including only bots matching specified regexes (note: only games with all bots present are considered)')
     parser_show.add_argument('-x', '--exclude', type=str, default=None, nargs='+', help='recalculates ranking excluding bots matching specified regexes')
-    parser_show.add_argument('-s', '--resample', type=int, default=None, help='recalculates ranking using bootstrapping')
+    parser_show.add_argument('-s', '--resample', type=int, default=None, help='recalculates ranking using bootstrapping (with -B: number of games in each sample, all selected games by default)')
+    parser_show.add_argument('-B', '--bootstrap', type=int, default=None, help='runs B resample passes in parallel and adds mean, std & percentile interval of each score to the ranking')
+    parser_show.add_argument('-j', '--jobs', type=int, default=None, help='number of processes used by --bootstrap (default: number of cpus)')
     parser_show_xgroup = parser_show.add_mutually_exclusive_group()
     parser_show_xgroup.add_argument('-b', '--best', type=int, default=None, help='limits ranking to the best X bots')
     parser_show_xgroup.add_argument('-r', '--recent', type=int, default=None, help='limits ranking to the most recent X bots')
@@ -1014,12 +1800,25 @@ def _main() -> None:
     parser_info.add_argument('-a', '--active', action='store_true', help='shows only active bots')
     parser_info.add_argument('-o', '--output', choices=['table','csv','json'], default=None, help='output format of the ranking')
 
+    parser_sprt = subparsers.add_parser('sprt', help='plays pairs of games between two bots until a sequential probability ratio test (GSPRT) accepts one of the hypotheses\nthe verdict is appended to file_sprt, games are not added to the league')
+    parser_sprt.set_defaults(func=mode_sprt)
+    parser_sprt.add_argument('bot1', help='name of the tested bot')
+    parser_sprt.add_argument('bot2', help='name of the baseline bot')
+    parser_sprt.add_argument('--elo0', type=float, default=None, help='elo difference of H0 (overrides config file)')
+    parser_sprt.add_argument('--elo1', type=float, default=None, help='elo difference of H1 (overrides config file)')
+    parser_sprt.add_argument('--alpha', type=float, default=None, help='probability of accepting H1 when H0 is true (overrides config file)')
+    parser_sprt.add_argument('--beta', type=float, default=None, help='probability of accepting H0 when H1 is true (overrides config file)')
+    parser_sprt.add_argument('-p', '--max-pairs', type=int, default=None, help='stops without a verdict after this many pairs of games')
+    parser_sprt.add_argument('-w', '--workers', type=int, default=None, help='number of workers to use (overrides config file)')
+    parser_sprt.add_argument('-v', '--verbose', action='store_true', help='shows extra information, good for debugging')
+
     parser_db = subparsers.add_parser('db', aliases=['d'], help='operations on the database')
     parser_db_subparsers = parser_db.add_subparsers(title='db modes', required=True)
     parser_db_recreate = parser_db_subparsers.add_parser('recreate', help='recreates the ranking using all of the games (warning: not useful unless your db file is corrupted)')
     parser_db_recreate.set_defaults(func=mode_db_recreate)
     parser_db_recreate.add_argument('-y', '--force-confirm', action='store_true', help='skips the confirmation prompt')
     parser_db_recreate.add_argument('-s', '--shuffle', action='store_true', help='shuffles the games before recalculating the ranking')
+    parser_db_recreate.add_argument('-f', '--full', action='store_true', help='ignores rating checkpoints and replays all of the games from scratch')
     parser_db_verify = parser_db_subparsers.add_parser('verify', help='verifies the integrity of the database')
     parser_db_verify.set_defaults(func=mode_db_verify)
 
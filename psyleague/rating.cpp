@@ -0,0 +1,481 @@
+/*
+    Native batch rating kernel for psyleague.
+
+    trueskill_rate() replays a sequence of games (each game = n_players ids, ranks & errors, teams of
+    a single player) and updates flat arrays of ratings in place. It follows the factor graph,
+    message schedule and numerical approximations (erfc, ppf) of the trueskill package, so the
+    results match trueskill.rate() within floating point tolerance.
+
+    Built as an optional extension (see setup.py); psyleague falls back to the trueskill package
+    when the extension is not available.
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+
+const double INF = std::numeric_limits<double>::infinity();
+const double PI = 3.14159265358979323846;
+const double MIN_DELTA = 0.0001;
+const int MAX_ITERATIONS = 10;
+
+/*
+    Same approximations as trueskill.mathematics
+*/
+
+double erfc_approx(double x)
+{
+    double z = std::fabs(x);
+    double t = 1. / (1. + z / 2.);
+    double r = t * std::exp(
+        -z * z - 1.26551223 +
+        t * (1.00002368 +
+        t * (0.37409196 +
+        t * (0.09678418 +
+        t * (-0.18628806 +
+        t * (0.27886807 +
+        t * (-1.13520398 +
+        t * (1.48851587 +
+        t * (-0.82215223 +
+        t * 0.17087277)))))))));
+    return x < 0 ? 2. - r : r;
+}
+
+double erfcinv_approx(double y)
+{
+    if (y >= 2)
+        return -100.;
+    if (y <= 0)
+        return 100.;
+    bool zero_point = y < 1;
+    if (!zero_point)
+        y = 2. - y;
+    double t = std::sqrt(-2 * std::log(y / 2.));
+    double x = -0.70711 * ((2.30753 + t * 0.27061) / (1. + t * (0.99229 + t * 0.04481)) - t);
+    for (int i = 0; i < 2; i++)
+    {
+        double err = erfc_approx(x) - y;
+        x += err / (1.12837916709551257 * std::exp(-(x * x)) - x * err);
+    }
+    return zero_point ? x : -x;
+}
+
+double cdf(double x)
+{
+    return 0.5 * erfc_approx(-x / std::sqrt(2.));
+}
+
+double pdf(double x)
+{
+    return 1 / std::sqrt(2 * PI) * std::exp(-(x * x / 2));
+}
+
+double ppf(double x)
+{
+    return -std::sqrt(2.) * erfcinv_approx(2 * x);
+}
+
+/*
+    Truncated gaussian corrections, set *error instead of raising FloatingPointError
+*/
+
+double v_win(double diff, double draw_margin)
+{
+    double x = diff - draw_margin;
+    double denom = cdf(x);
+    return denom != 0 ? pdf(x) / denom : -x;
+}
+
+double w_win(double diff, double draw_margin, bool *error)
+{
+    double x = diff - draw_margin;
+    double v = v_win(diff, draw_margin);
+    double w = v * (v + x);
+    if (!(0 < w && w < 1))
+        *error = true;
+    return w;
+}
+
+double v_draw(double diff, double draw_margin)
+{
+    double abs_diff = std::fabs(diff);
+    double a = draw_margin - abs_diff;
+    double b = -draw_margin - abs_diff;
+    double denom = cdf(a) - cdf(b);
+    double numer = pdf(b) - pdf(a);
+    return (denom != 0 ? numer / denom : a) * (diff < 0 ? -1 : +1);
+}
+
+double w_draw(double diff, double draw_margin, bool *error)
+{
+    double abs_diff = std::fabs(diff);
+    double a = draw_margin - abs_diff;
+    double b = -draw_margin - abs_diff;
+    double denom = cdf(a) - cdf(b);
+    if (denom == 0)
+    {
+        *error = true;
+        return 0;
+    }
+    double v = v_draw(abs_diff, draw_margin);
+    return v * v + (a * pdf(a) - b * pdf(b)) / denom;
+}
+
+/*
+    Factor graph of a single game, gaussians are kept in (pi, tau) form like in trueskill
+*/
+
+struct Gaussian
+{
+    double pi = 0;
+    double tau = 0;
+
+    Gaussian() = default;
+    Gaussian(double pi, double tau) : pi(pi), tau(tau) {}
+
+    static Gaussian from_mu_sigma(double mu, double sigma)
+    {
+        double pi = 1 / (sigma * sigma);
+        return Gaussian(pi, pi * mu);
+    }
+
+    double mu() const { return pi != 0 ? tau / pi : 0; }
+    double sigma() const { return pi != 0 ? std::sqrt(1 / pi) : INF; }
+
+    Gaussian operator*(const Gaussian &other) const { return Gaussian(pi + other.pi, tau + other.tau); }
+    Gaussian operator/(const Gaussian &other) const { return Gaussian(pi - other.pi, tau - other.tau); }
+};
+
+struct Variable
+{
+    Gaussian value;
+
+    double set(const Gaussian &new_value)
+    {
+        double pi_delta = std::fabs(value.pi - new_value.pi);
+        double delta = pi_delta == INF ? 0. : std::max(std::fabs(value.tau - new_value.tau), std::sqrt(pi_delta));
+        value = new_value;
+        return delta;
+    }
+
+    // message: the message this variable holds from the factor that sends the update
+    double update_message(Gaussian *message, const Gaussian &new_message)
+    {
+        Gaussian old_message = *message;
+        *message = new_message;
+        return set(value / old_message * new_message);
+    }
+
+    double update_value(Gaussian *message, const Gaussian &new_value)
+    {
+        *message = new_value * *message / value;
+        return set(new_value);
+    }
+};
+
+class GameGraph
+{
+    public:
+        GameGraph(double beta, double tau, double draw_margin)
+            : _beta_sq(beta * beta), _tau(tau), _draw_margin(draw_margin)
+        {
+        }
+
+        // mu / sigma are sorted by rank, ties[i] tells if players i & i+1 have the same rank
+        bool rate(int n, double *mu, double *sigma, const char *ties)
+        {
+            _resize(n);
+            bool error = false;
+
+            // prior, perf & team perf layers
+            for (int i = 0; i < n; i++)
+            {
+                double dynamic_sigma = std::sqrt(sigma[i] * sigma[i] + _tau * _tau);
+                _skill[i].update_value(&_skill_prior_msg[i], Gaussian::from_mu_sigma(mu[i], dynamic_sigma));
+            }
+            for (int i = 0; i < n; i++)
+                _likelihood_down(i);
+            for (int i = 0; i < n; i++)
+                _sum_update(&_team[i], &_team_perf_msg[i], &_perf[i], &_perf_team_msg[i], 1., nullptr, nullptr, 0.);
+
+            // team diff & truncation layers
+            int diffs = n - 1;
+            for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+            {
+                double delta = 0;
+                if (diffs == 1)
+                {
+                    _diff_down(0);
+                    delta = _trunc_up(0, ties[0], &error);
+                }
+                else
+                {
+                    for (int x = 0; x < diffs - 1; x++)
+                    {
+                        _diff_down(x);
+                        delta = std::max(delta, _trunc_up(x, ties[x], &error));
+                        _diff_up(x, 1);
+                    }
+                    for (int x = diffs - 1; x > 0; x--)
+                    {
+                        _diff_down(x);
+                        delta = std::max(delta, _trunc_up(x, ties[x], &error));
+                        _diff_up(x, 0);
+                    }
+                }
+                if (delta <= MIN_DELTA)
+                    break;
+            }
+            _diff_up(0, 0);
+            _diff_up(diffs - 1, 1);
+
+            // back to skills
+            for (int i = 0; i < n; i++)
+                _sum_update(&_perf[i], &_perf_team_msg[i], &_team[i], &_team_perf_msg[i], 1., nullptr, nullptr, 0.);
+            for (int i = 0; i < n; i++)
+                _likelihood_up(i);
+
+            for (int i = 0; i < n; i++)
+            {
+                mu[i] = _skill[i].value.mu();
+                sigma[i] = _skill[i].value.sigma();
+            }
+            return !error;
+        }
+
+    private:
+        double _beta_sq;
+        double _tau;
+        double _draw_margin;
+
+        // variables and the messages they hold from each connected factor
+        std::vector<Variable> _skill, _perf, _team, _diff;
+        std::vector<Gaussian> _skill_prior_msg, _skill_likelihood_msg;
+        std::vector<Gaussian> _perf_likelihood_msg, _perf_team_msg;
+        std::vector<Gaussian> _team_perf_msg, _team_left_diff_msg, _team_right_diff_msg;
+        std::vector<Gaussian> _diff_sum_msg, _diff_trunc_msg;
+
+        void _resize(int n)
+        {
+            for (auto *v : {&_skill, &_perf, &_team})
+                v->assign(n, Variable());
+            _diff.assign(n - 1, Variable());
+            for (auto *m : {&_skill_prior_msg, &_skill_likelihood_msg, &_perf_likelihood_msg, &_perf_team_msg,
+                            &_team_perf_msg, &_team_left_diff_msg, &_team_right_diff_msg})
+                m->assign(n, Gaussian());
+            _diff_sum_msg.assign(n - 1, Gaussian());
+            _diff_trunc_msg.assign(n - 1, Gaussian());
+        }
+
+        void _likelihood_down(int i)
+        {
+            Gaussian msg = _skill[i].value / _skill_likelihood_msg[i];
+            double a = 1. / (1. + _beta_sq * msg.pi);
+            _perf[i].update_message(&_perf_likelihood_msg[i], Gaussian(a * msg.pi, a * msg.tau));
+        }
+
+        void _likelihood_up(int i)
+        {
+            Gaussian msg = _perf[i].value / _perf_likelihood_msg[i];
+            double a = 1. / (1. + _beta_sq * msg.pi);
+            _skill[i].update_message(&_skill_likelihood_msg[i], Gaussian(a * msg.pi, a * msg.tau));
+        }
+
+        // SumFactor.update with up to two terms (second term is skipped when val2 is null)
+        void _sum_update(Variable *var, Gaussian *var_msg, const Variable *val1, const Gaussian *msg1, double coeff1,
+                         const Variable *val2, const Gaussian *msg2, double coeff2)
+        {
+            double pi_inv = 0;
+            double mu = 0;
+            const Variable *vals[2] = {val1, val2};
+            const Gaussian *msgs[2] = {msg1, msg2};
+            double coeffs[2] = {coeff1, coeff2};
+            for (int k = 0; k < 2 && vals[k]; k++)
+            {
+                Gaussian div = vals[k]->value / *msgs[k];
+                mu += coeffs[k] * div.mu();
+                if (pi_inv == INF)
+                    continue;
+                if (div.pi == 0)
+                    pi_inv = INF;
+                else
+                    pi_inv += coeffs[k] * coeffs[k] / div.pi;
+            }
+            double pi = 1. / pi_inv;
+            var->update_message(var_msg, Gaussian(pi, pi * mu));
+        }
+
+        void _diff_down(int x)
+        {
+            _sum_update(&_diff[x], &_diff_sum_msg[x], &_team[x], &_team_right_diff_msg[x], +1.,
+                        &_team[x + 1], &_team_left_diff_msg[x + 1], -1.);
+        }
+
+        void _diff_up(int x, int index)
+        {
+            if (index == 0)
+                _sum_update(&_team[x], &_team_right_diff_msg[x], &_diff[x], &_diff_sum_msg[x], 1.,
+                            &_team[x + 1], &_team_left_diff_msg[x + 1], 1.);
+            else
+                _sum_update(&_team[x + 1], &_team_left_diff_msg[x + 1], &_team[x], &_team_right_diff_msg[x], 1.,
+                            &_diff[x], &_diff_sum_msg[x], -1.);
+        }
+
+        double _trunc_up(int x, bool tie, bool *error)
+        {
+            Gaussian div = _diff[x].value / _diff_trunc_msg[x];
+            double sqrt_pi = std::sqrt(div.pi);
+            double diff = div.tau / sqrt_pi;
+            double draw_margin = _draw_margin * sqrt_pi;
+            double v = tie ? v_draw(diff, draw_margin) : v_win(diff, draw_margin);
+            double w = tie ? w_draw(diff, draw_margin, error) : w_win(diff, draw_margin, error);
+            double denom = 1. - w;
+            return _diff[x].update_value(&_diff_trunc_msg[x], Gaussian(div.pi / denom, (div.tau + sqrt_pi * v) / denom));
+        }
+};
+
+struct Buffer
+{
+    Py_buffer view = {};
+
+    ~Buffer()
+    {
+        if (view.obj)
+            PyBuffer_Release(&view);
+    }
+};
+
+bool check_buffer(const Buffer &buffer, Py_ssize_t item_size, Py_ssize_t length, const char *name)
+{
+    if (buffer.view.itemsize != item_size || buffer.view.len != item_size * length)
+    {
+        PyErr_Format(PyExc_ValueError, "%s has invalid item size or length", name);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+/*
+    trueskill_rate(players, ranks, errors, n_players, mu, sigma, games, bot_errors, tau, beta, draw_probability, skip_errors)
+
+    players/ranks/errors: int32 buffers of n_games * n_players (row per game)
+    mu/sigma: float64 buffers indexed by player id, games/bot_errors: int64 buffers indexed by player id
+    all of the per-player buffers are updated in place
+*/
+static PyObject *trueskill_rate(PyObject *, PyObject *args)
+{
+    Buffer players, ranks, errors, mu, sigma, games, bot_errors;
+    int n_players, skip_errors;
+    double tau, beta, draw_probability;
+    if (!PyArg_ParseTuple(args, "y*y*y*iw*w*w*w*dddp", &players.view, &ranks.view, &errors.view, &n_players,
+                          &mu.view, &sigma.view, &games.view, &bot_errors.view, &tau, &beta, &draw_probability,
+                          &skip_errors))
+        return nullptr;
+
+    if (n_players < 2)
+    {
+        PyErr_SetString(PyExc_ValueError, "n_players has to be at least 2");
+        return nullptr;
+    }
+    Py_ssize_t n_games = players.view.len / (Py_ssize_t)sizeof(int32_t) / n_players;
+    Py_ssize_t n_bots = mu.view.len / (Py_ssize_t)sizeof(double);
+    if (!check_buffer(players, sizeof(int32_t), n_games * n_players, "players") ||
+        !check_buffer(ranks, sizeof(int32_t), n_games * n_players, "ranks") ||
+        !check_buffer(errors, sizeof(int32_t), n_games * n_players, "errors") ||
+        !check_buffer(sigma, sizeof(double), n_bots, "sigma") || !check_buffer(games, sizeof(int64_t), n_bots, "games") ||
+        !check_buffer(bot_errors, sizeof(int64_t), n_bots, "bot_errors"))
+        return nullptr;
+
+    const int32_t *players_data = (const int32_t *)players.view.buf;
+    const int32_t *ranks_data = (const int32_t *)ranks.view.buf;
+    const int32_t *errors_data = (const int32_t *)errors.view.buf;
+    double *mu_data = (double *)mu.view.buf;
+    double *sigma_data = (double *)sigma.view.buf;
+    int64_t *games_data = (int64_t *)games.view.buf;
+    int64_t *bot_errors_data = (int64_t *)bot_errors.view.buf;
+
+    for (Py_ssize_t i = 0; i < n_games * n_players; i++)
+    {
+        if (players_data[i] < 0 || players_data[i] >= n_bots)
+        {
+            PyErr_SetString(PyExc_ValueError, "player id out of range");
+            return nullptr;
+        }
+    }
+
+    double draw_margin = ppf((draw_probability + 1) / 2.) * std::sqrt(2.) * beta;
+    bool ok = true;
+
+    Py_BEGIN_ALLOW_THREADS
+
+    GameGraph graph(beta, tau, draw_margin);
+    std::vector<int> order(n_players);
+    std::vector<double> game_mu(n_players), game_sigma(n_players);
+    std::vector<char> ties(n_players);
+    for (Py_ssize_t g = 0; g < n_games && ok; g++)
+    {
+        const int32_t *game_players = players_data + g * n_players;
+        const int32_t *game_ranks = ranks_data + g * n_players;
+        const int32_t *game_errors = errors_data + g * n_players;
+
+        bool any_error = false;
+        for (int i = 0; i < n_players; i++)
+        {
+            games_data[game_players[i]]++;
+            bot_errors_data[game_players[i]] += game_errors[i];
+            any_error |= game_errors[i] != 0;
+        }
+        if (skip_errors && any_error)
+            continue;
+
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return game_ranks[a] < game_ranks[b]; });
+        for (int i = 0; i < n_players; i++)
+        {
+            game_mu[i] = mu_data[game_players[order[i]]];
+            game_sigma[i] = sigma_data[game_players[order[i]]];
+            if (i + 1 < n_players)
+                ties[i] = game_ranks[order[i]] == game_ranks[order[i + 1]];
+        }
+        ok = graph.rate(n_players, game_mu.data(), game_sigma.data(), ties.data());
+        for (int i = 0; i < n_players; i++)
+        {
+            mu_data[game_players[order[i]]] = game_mu[i];
+            sigma_data[game_players[order[i]]] = game_sigma[i];
+        }
+    }
+
+    Py_END_ALLOW_THREADS
+
+    if (!ok)
+    {
+        PyErr_SetString(PyExc_FloatingPointError, "trueskill rating update failed (extreme rating difference)");
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef rating_methods[] = {
+    {"trueskill_rate", trueskill_rate, METH_VARARGS, "Replays games and updates trueskill ratings in place."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+static struct PyModuleDef rating_module = {
+    PyModuleDef_HEAD_INIT, "_rating", "Native batch rating kernel for psyleague.", -1, rating_methods,
+};
+
+PyMODINIT_FUNC PyInit__rating(void)
+{
+    return PyModule_Create(&rating_module);
+}
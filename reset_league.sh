@@ -1,6 +1,6 @@
 #!/bin/sh
 
-rm psyleague.db && rm psyleague.games
+rm -f psyleague.db psyleague.games psyleague.journal
 
 psyleague bot add BbMctsPv-3.7.6 -s ../codingame_chess/cgmains/cgmain_BbMctsPv-3.7.6
 #psyleague bot add BbMctsPv-3.7.7 -s ../codingame_chess/cgmains/cgmain_BbMctsPv-3.7.7
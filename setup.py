@@ -1,10 +1,12 @@
-from setuptools import setup
+from setuptools import setup, Extension
 __version__ = '0.4.1'
 
 setup(
     name = 'psyleague',
     packages = ['psyleague'],
     package_data = {'psyleague': ['psyleague.cfg']},
+    # optional native rating kernel, psyleague falls back to pure python if it can't be built
+    ext_modules = [Extension('psyleague._rating', sources=['psyleague/rating.cpp'], language='c++', optional=True)],
     version = __version__,
     license = 'MIT',
     description = "Local league system for bot contests.",